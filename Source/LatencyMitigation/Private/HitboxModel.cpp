@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HitboxModel.h"
+
+FHitboxQuery::FHitboxQuery(const FVector& inRayStart, const FVector& inRayEnd) :
+	rayStart{ inRayStart },
+	rayDelta{ inRayEnd - inRayStart }
+{
+}
+
+void FHitboxQuery::AddShapes(const TArray<FHitboxShape>& inShapes, const FHitboxPose& pose, int32 owner)
+{
+	// Yaw only rotates the offsets, capsule segments stay vertical
+	FQuat rotation = FRotator{ 0.f, pose.yaw, 0.f }.Quaternion();
+	for (int32 i = 0; i < inShapes.Num(); ++i)
+	{
+		const FHitboxShape& shape = inShapes[i];
+		FVector3f segmentStart{ pose.location + rotation.RotateVector(shape.LocalOffset) - rayStart };
+		segmentStart.Z -= shape.HalfHeight;
+
+		segmentX.Add(segmentStart.X);
+		segmentY.Add(segmentStart.Y);
+		segmentZ.Add(segmentStart.Z);
+		axisZ.Add(2.f * shape.HalfHeight);
+		radius.Add(shape.Radius);
+		owners.Add(owner);
+		shapes.Add(i);
+	}
+}
+
+bool FHitboxQuery::Raycast(FHitboxHit& outHit) const
+{
+	const int32 numShapes = owners.Num();
+	const float rayLengthSquared = rayDelta.SizeSquared();
+	if (numShapes == 0 || rayLengthSquared <= KINDA_SMALL_NUMBER)
+	{
+		return false;
+	}
+
+	const float rayLength = FMath::Sqrt(rayLengthSquared);
+	const float invRayLengthSquared = 1.f / rayLengthSquared;
+
+	TArray<float, TInlineAllocator<32>> entry;
+	entry.SetNumUninitialized(numShapes);
+
+	// Closest points between the ray segment and each shape's vertical segment, solved with clamps instead of branches
+	for (int32 i = 0; i < numShapes; ++i)
+	{
+		const float offsetX = -segmentX[i];
+		const float offsetY = -segmentY[i];
+		const float offsetZ = -segmentZ[i];
+		const float e = axisZ[i] * axisZ[i];
+		const float invE = e > KINDA_SMALL_NUMBER ? 1.f / e : 0.f;
+		const float b = rayDelta.Z * axisZ[i];
+		const float c = rayDelta.X * offsetX + rayDelta.Y * offsetY + rayDelta.Z * offsetZ;
+		const float f = axisZ[i] * offsetZ;
+
+		const float denom = rayLengthSquared * e - b * b;
+		float s = denom > KINDA_SMALL_NUMBER ? FMath::Clamp((b * f - c * e) / denom, 0.f, 1.f) : 0.f;
+		const float t = FMath::Clamp((b * s + f) * invE, 0.f, 1.f);
+		s = FMath::Clamp((b * t - c) * invRayLengthSquared, 0.f, 1.f);
+
+		const float dx = rayDelta.X * s - segmentX[i];
+		const float dy = rayDelta.Y * s - segmentY[i];
+		const float dz = rayDelta.Z * s - (segmentZ[i] + axisZ[i] * t);
+		const float distanceSquared = dx * dx + dy * dy + dz * dz;
+		const float radiusSquared = radius[i] * radius[i];
+
+		const float penetration = FMath::Sqrt(FMath::Max(radiusSquared - distanceSquared, 0.f));
+		const float hitDistance = FMath::Max(s * rayLength - penetration, 0.f);
+		entry[i] = distanceSquared <= radiusSquared ? hitDistance : MAX_flt;
+	}
+
+	int32 closest = INDEX_NONE;
+	float closestDistance = MAX_flt;
+	for (int32 i = 0; i < numShapes; ++i)
+	{
+		if (entry[i] < closestDistance)
+		{
+			closestDistance = entry[i];
+			closest = i;
+		}
+	}
+
+	if (closest == INDEX_NONE)
+	{
+		return false;
+	}
+
+	outHit.owner = owners[closest];
+	outHit.shape = shapes[closest];
+	outHit.distance = closestDistance;
+	return true;
+}
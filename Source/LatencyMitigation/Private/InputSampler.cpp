@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InputSampler.h"
+#include "PlayerCharacter.h"
+
+void FInputSampler::AddSample(EInputSampleAxis axis, float value)
+{
+	AddSample(axis, value, FPlatformTime::Seconds());
+}
+
+void FInputSampler::AddSample(EInputSampleAxis axis, float value, double sampleTime)
+{
+	firstSampleTime = numSamples++ == 0 ? sampleTime : FMath::Min(firstSampleTime, sampleTime);
+	sums[int32(axis)] += value;
+}
+
+void FInputSampler::Flush(FPlayerMove& move)
+{
+	move.forwardAxis = FMath::Clamp(sums[int32(EInputSampleAxis::Forward)], -1.f, 1.f);
+	move.rightAxis = FMath::Clamp(sums[int32(EInputSampleAxis::Right)], -1.f, 1.f);
+	move.playerRotation = sums[int32(EInputSampleAxis::Turn)];
+	move.lookAtRotation = sums[int32(EInputSampleAxis::LookUp)];
+
+	FMemory::Memzero(sums);
+	numSamples = 0;
+}
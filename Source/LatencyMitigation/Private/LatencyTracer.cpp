@@ -0,0 +1,206 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LatencyTracer.h"
+
+DECLARE_STATS_GROUP(TEXT("LatencyTrace"), STATGROUP_LatencyTrace, STATCAT_Advanced);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Input to send p50 (ms)"), STAT_InputToSendP50, STATGROUP_LatencyTrace);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Input to send p99 (ms)"), STAT_InputToSendP99, STATGROUP_LatencyTrace);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Network round trip p50 (ms)"), STAT_NetworkRoundTripP50, STATGROUP_LatencyTrace);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Network round trip p99 (ms)"), STAT_NetworkRoundTripP99, STATGROUP_LatencyTrace);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Server receive to apply p50 (ms)"), STAT_ServerReceiveToApplyP50, STATGROUP_LatencyTrace);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Server receive to apply p99 (ms)"), STAT_ServerReceiveToApplyP99, STATGROUP_LatencyTrace);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Server apply to ack p50 (ms)"), STAT_ServerApplyToAckP50, STATGROUP_LatencyTrace);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Server apply to ack p99 (ms)"), STAT_ServerApplyToAckP99, STATGROUP_LatencyTrace);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Receive to reconcile p50 (ms)"), STAT_ReceiveToReconcileP50, STATGROUP_LatencyTrace);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Receive to reconcile p99 (ms)"), STAT_ReceiveToReconcileP99, STATGROUP_LatencyTrace);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Reconcile to render p50 (ms)"), STAT_ReconcileToRenderP50, STATGROUP_LatencyTrace);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Reconcile to render p99 (ms)"), STAT_ReconcileToRenderP99, STATGROUP_LatencyTrace);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Input to render p50 (ms)"), STAT_TotalP50, STATGROUP_LatencyTrace);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Input to render p99 (ms)"), STAT_TotalP99, STATGROUP_LatencyTrace);
+
+static const FName StageNames[] =
+{
+	TEXT("InputToSend"),
+	TEXT("NetworkRoundTrip"),
+	TEXT("ServerReceiveToApply"),
+	TEXT("ServerApplyToAck"),
+	TEXT("ReceiveToReconcile"),
+	TEXT("ReconcileToRender"),
+	TEXT("Total")
+};
+static_assert(UE_ARRAY_COUNT(StageNames) == int32(ELatencyStage::Count), "Every latency stage needs a name");
+
+FLatencyTracer::FLatencyTracer()
+{
+	for (TArray<uint32>& histogram : histograms)
+	{
+		histogram.SetNumZeroed(NumBuckets);
+	}
+}
+
+uint32 FLatencyTracer::BeginTrace(double sampleTime)
+{
+	// Traces whose input or ack was lost never complete
+	double now = FPlatformTime::Seconds();
+	for (auto it = activeTraces.CreateIterator(); it; ++it)
+	{
+		if (now - it->Value.sampleTime > 2.0)
+		{
+			it.RemoveCurrent();
+		}
+	}
+
+	uint32 traceId = nextTraceId++;
+	if (nextTraceId == 0)
+	{
+		nextTraceId = 1;
+	}
+
+	FTrace& trace = activeTraces.Add(traceId);
+	trace.sampleTime = sampleTime;
+	return traceId;
+}
+
+void FLatencyTracer::MarkSent(uint32 traceId)
+{
+	FTrace* trace = activeTraces.Find(traceId);
+	if (trace && trace->sendTime == 0.0)
+	{
+		trace->sendTime = FPlatformTime::Seconds();
+	}
+}
+
+void FLatencyTracer::MarkReceived(uint32 traceId, float serverReceiveToApplyMs, float serverApplyToAckMs)
+{
+	FTrace* trace = activeTraces.Find(traceId);
+	if (trace && trace->sendTime > 0.0 && trace->receiveTime == 0.0)
+	{
+		trace->receiveTime = FPlatformTime::Seconds();
+		trace->serverReceiveToApplyMs = serverReceiveToApplyMs;
+		trace->serverApplyToAckMs = serverApplyToAckMs;
+	}
+}
+
+void FLatencyTracer::MarkReconciled(uint32 traceId)
+{
+	FTrace* trace = activeTraces.Find(traceId);
+	if (trace && trace->receiveTime > 0.0 && trace->reconcileTime == 0.0)
+	{
+		trace->reconcileTime = FPlatformTime::Seconds();
+		awaitingRender.Add(traceId);
+	}
+}
+
+void FLatencyTracer::CompleteRenderedTraces()
+{
+	if (awaitingRender.Num() == 0)
+	{
+		return;
+	}
+
+	double renderTime = FPlatformTime::Seconds();
+	for (uint32 traceId : awaitingRender)
+	{
+		FTrace trace;
+		if (!activeTraces.RemoveAndCopyValue(traceId, trace))
+		{
+			continue;
+		}
+
+		double serverMs = trace.serverReceiveToApplyMs + trace.serverApplyToAckMs;
+		AddSample(ELatencyStage::InputToSend, (trace.sendTime - trace.sampleTime) * 1000.0);
+		AddSample(ELatencyStage::NetworkRoundTrip, FMath::Max((trace.receiveTime - trace.sendTime) * 1000.0 - serverMs, 0.0));
+		AddSample(ELatencyStage::ServerReceiveToApply, trace.serverReceiveToApplyMs);
+		AddSample(ELatencyStage::ServerApplyToAck, trace.serverApplyToAckMs);
+		AddSample(ELatencyStage::ReceiveToReconcile, (trace.reconcileTime - trace.receiveTime) * 1000.0);
+		AddSample(ELatencyStage::ReconcileToRender, (renderTime - trace.reconcileTime) * 1000.0);
+		AddSample(ELatencyStage::Total, (renderTime - trace.sampleTime) * 1000.0);
+	}
+	awaitingRender.Reset();
+}
+
+void FLatencyTracer::AddSample(ELatencyStage stage, double ms)
+{
+	histograms[int32(stage)][GetBucket(ms)]++;
+	counts[int32(stage)]++;
+}
+
+int32 FLatencyTracer::GetBucket(double ms)
+{
+	if (ms < MinBucketMs)
+	{
+		return 0;
+	}
+	int32 bucket = 1 + FMath::FloorToInt32(float(FMath::Loge(ms / MinBucketMs) / FMath::Loge(double(BucketGrowth))));
+	return FMath::Clamp(bucket, 1, NumBuckets - 1);
+}
+
+float FLatencyTracer::GetBucketUpperMs(int32 bucket)
+{
+	return MinBucketMs * FMath::Pow(BucketGrowth, float(bucket));
+}
+
+float FLatencyTracer::GetPercentile(ELatencyStage stage, float percentile) const
+{
+	uint32 count = counts[int32(stage)];
+	if (count == 0)
+	{
+		return 0.f;
+	}
+
+	// Upper edge of the bucket holding the requested rank
+	uint32 target = FMath::Max(1u, uint32(FMath::CeilToInt32(percentile * count)));
+	uint32 seen = 0;
+	const TArray<uint32>& histogram = histograms[int32(stage)];
+	for (int32 bucket = 0; bucket < NumBuckets; ++bucket)
+	{
+		seen += histogram[bucket];
+		if (seen >= target)
+		{
+			return GetBucketUpperMs(bucket);
+		}
+	}
+	return GetBucketUpperMs(NumBuckets - 1);
+}
+
+void FLatencyTracer::GetSummaries(TArray<FLatencyStageSummary>& outSummaries) const
+{
+	outSummaries.SetNum(int32(ELatencyStage::Count));
+	for (int32 stage = 0; stage < int32(ELatencyStage::Count); ++stage)
+	{
+		FLatencyStageSummary& summary = outSummaries[stage];
+		summary.Stage = StageNames[stage];
+		summary.Count = counts[stage];
+		summary.P50Ms = GetPercentile(ELatencyStage(stage), 0.5f);
+		summary.P95Ms = GetPercentile(ELatencyStage(stage), 0.95f);
+		summary.P99Ms = GetPercentile(ELatencyStage(stage), 0.99f);
+	}
+}
+
+void FLatencyTracer::PublishStats() const
+{
+	SET_FLOAT_STAT(STAT_InputToSendP50, GetPercentile(ELatencyStage::InputToSend, 0.5f));
+	SET_FLOAT_STAT(STAT_InputToSendP99, GetPercentile(ELatencyStage::InputToSend, 0.99f));
+	SET_FLOAT_STAT(STAT_NetworkRoundTripP50, GetPercentile(ELatencyStage::NetworkRoundTrip, 0.5f));
+	SET_FLOAT_STAT(STAT_NetworkRoundTripP99, GetPercentile(ELatencyStage::NetworkRoundTrip, 0.99f));
+	SET_FLOAT_STAT(STAT_ServerReceiveToApplyP50, GetPercentile(ELatencyStage::ServerReceiveToApply, 0.5f));
+	SET_FLOAT_STAT(STAT_ServerReceiveToApplyP99, GetPercentile(ELatencyStage::ServerReceiveToApply, 0.99f));
+	SET_FLOAT_STAT(STAT_ServerApplyToAckP50, GetPercentile(ELatencyStage::ServerApplyToAck, 0.5f));
+	SET_FLOAT_STAT(STAT_ServerApplyToAckP99, GetPercentile(ELatencyStage::ServerApplyToAck, 0.99f));
+	SET_FLOAT_STAT(STAT_ReceiveToReconcileP50, GetPercentile(ELatencyStage::ReceiveToReconcile, 0.5f));
+	SET_FLOAT_STAT(STAT_ReceiveToReconcileP99, GetPercentile(ELatencyStage::ReceiveToReconcile, 0.99f));
+	SET_FLOAT_STAT(STAT_ReconcileToRenderP50, GetPercentile(ELatencyStage::ReconcileToRender, 0.5f));
+	SET_FLOAT_STAT(STAT_ReconcileToRenderP99, GetPercentile(ELatencyStage::ReconcileToRender, 0.99f));
+	SET_FLOAT_STAT(STAT_TotalP50, GetPercentile(ELatencyStage::Total, 0.5f));
+	SET_FLOAT_STAT(STAT_TotalP99, GetPercentile(ELatencyStage::Total, 0.99f));
+}
+
+void FLatencyTracer::ResetHistograms()
+{
+	for (int32 stage = 0; stage < int32(ELatencyStage::Count); ++stage)
+	{
+		FMemory::Memzero(histograms[stage].GetData(), histograms[stage].Num() * sizeof(uint32));
+		counts[stage] = 0;
+	}
+}
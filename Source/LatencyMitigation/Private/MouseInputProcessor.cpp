@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MouseInputProcessor.h"
+#include "Engine/GameViewportClient.h"
+#include "UnrealClient.h"
+
+FMouseInputProcessor::FMouseInputProcessor(UGameViewportClient* inViewportClient) :
+	viewportClient(inViewportClient)
+{
+}
+
+bool FMouseInputProcessor::HandleMouseMoveEvent(FSlateApplication& SlateApp, const FPointerEvent& MouseEvent)
+{
+	UGameViewportClient* client = viewportClient.Get();
+	if (!client || !client->Viewport || !client->Viewport->HasMouseCapture())
+	{
+		return false;
+	}
+
+	FVector2D delta = MouseEvent.GetCursorDelta();
+	if (!delta.IsZero())
+	{
+		samples.Add(FMouseSample{ FPlatformTime::Seconds(), delta });
+	}
+	return false;
+}
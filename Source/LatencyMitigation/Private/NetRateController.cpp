@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NetRateController.h"
+#include "Engine/NetConnection.h"
+
+void FNetRateController::Initialize(const FNetRateSettings& inSettings)
+{
+	settings = inSettings;
+	sendInterval = FMath::Clamp(settings.InitialInterval, settings.MinInterval, settings.MaxInterval);
+	intervalScale = 1.f;
+	redundancy = settings.MinRedundancy;
+	timeSinceSend = 0.f;
+	timeSinceAdjust = 0.f;
+	smoothedRtt = 0.f;
+	minRtt = 0.f;
+	loss = 0.f;
+}
+
+bool FNetRateController::Update(float DeltaTime, UNetConnection* connection)
+{
+	timeSinceSend += DeltaTime;
+	timeSinceAdjust += DeltaTime;
+
+	if (connection && timeSinceAdjust >= settings.ControlPeriod)
+	{
+		timeSinceAdjust = 0.f;
+		Adjust(connection);
+	}
+
+	if (timeSinceSend >= sendInterval * intervalScale)
+	{
+		timeSinceSend = 0.f;
+		return true;
+	}
+	return false;
+}
+
+void FNetRateController::Adjust(UNetConnection* connection)
+{
+	float rtt = connection->AvgLag;
+	if (rtt > 0.f)
+	{
+		smoothedRtt = smoothedRtt > 0.f ? FMath::Lerp(smoothedRtt, rtt, 0.125f) : rtt;
+		minRtt = minRtt > 0.f ? FMath::Min(minRtt, rtt) : rtt;
+	}
+	loss = FMath::Max(connection->GetInLossPercentage().GetAvgLossPercentage(), connection->GetOutLossPercentage().GetAvgLossPercentage());
+
+	bool overBandwidth = connection->OutBytesPerSecond > settings.BandwidthTarget;
+	bool rttRising = minRtt > 0.f && smoothedRtt > minRtt * (1.f + settings.RttRiseThreshold);
+	bool saturated = !connection->IsNetReady(false);
+
+	if (overBandwidth || rttRising || saturated || loss > settings.LossThreshold)
+	{
+		sendInterval = FMath::Max(sendInterval, 0.001f) * settings.BackoffFactor;
+	}
+	else
+	{
+		sendInterval -= settings.RecoveryStep;
+	}
+	sendInterval = FMath::Clamp(sendInterval, settings.MinInterval, settings.MaxInterval);
+
+	// Loss is repaired by resending unacked moves, but not when the extra bytes are what is hurting us
+	if (overBandwidth || saturated)
+	{
+		redundancy = settings.MinRedundancy;
+	}
+	else
+	{
+		int32 lossRedundancy = FMath::CeilToInt(loss * 100.f * settings.RedundancyPerLossPercent);
+		redundancy = FMath::Clamp(lossRedundancy, settings.MinRedundancy, settings.MaxRedundancy);
+	}
+}
@@ -0,0 +1,297 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NetworkSweepRunner.h"
+#include "PlayerCharacter.h"
+#include "Engine/NetDriver.h"
+#include "Engine/NetConnection.h"
+#include "PlayerRegistrySubsystem.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+ANetworkSweepRunner::ANetworkSweepRunner()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	bReplicates = false;
+}
+
+void ANetworkSweepRunner::BeginPlay()
+{
+	Super::BeginPlay();
+	frameTimer.Start(GetWorld());
+	if (StartOnBeginPlay && HasAuthority())
+	{
+		StartSweep();
+	}
+}
+
+void ANetworkSweepRunner::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	StopSweep();
+	frameTimer.Stop();
+	Super::EndPlay(EndPlayReason);
+}
+
+void ANetworkSweepRunner::StartSweep()
+{
+	if (!HasAuthority() || Profiles.Num() == 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Network sweep needs authority and at least one profile"));
+		return;
+	}
+
+	Results.Reset();
+	BeginProfile(0);
+}
+
+void ANetworkSweepRunner::StopSweep()
+{
+	if (!IsRunning())
+	{
+		return;
+	}
+
+	currentProfile = INDEX_NONE;
+	measuring = false;
+	collecting = false;
+	SetScriptedSession(false);
+	ApplyProfile(FNetEmulationProfile{});
+}
+
+void ANetworkSweepRunner::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!IsRunning())
+	{
+		return;
+	}
+
+	profileTime += DeltaTime;
+	if (collecting)
+	{
+		if (profileTime >= WarmupDuration + ProfileDuration + CollectDuration)
+		{
+			FinishProfile();
+		}
+		return;
+	}
+
+	if (!measuring)
+	{
+		if (profileTime >= WarmupDuration)
+		{
+			BeginMeasuring();
+		}
+		return;
+	}
+
+	UNetDriver* netDriver = GetWorld()->GetNetDriver();
+	if (netDriver)
+	{
+		for (UNetConnection* connection : netDriver->ClientConnections)
+		{
+			if (connection)
+			{
+				inBytesPerSecondSum += connection->InBytesPerSecond;
+				outBytesPerSecondSum += connection->OutBytesPerSecond;
+			}
+		}
+	}
+
+	float frameMs = frameTimer.GetLastFrameMs();
+	serverFrameMsSum += frameMs;
+	serverFrameMsMax = FMath::Max(serverFrameMsMax, frameMs);
+	samples++;
+
+	if (profileTime >= WarmupDuration + ProfileDuration)
+	{
+		EndMeasuring();
+	}
+}
+
+void ANetworkSweepRunner::BeginProfile(int32 profileIndex)
+{
+	currentProfile = profileIndex;
+	profileTime = 0.f;
+	measuring = false;
+	collecting = false;
+
+	UE_LOG(LogTemp, Warning, TEXT("Network sweep: profile %d/%d '%s'"), profileIndex + 1, Profiles.Num(), *Profiles[profileIndex].Name);
+	ApplyProfile(Profiles[profileIndex]);
+	SetScriptedSession(true);
+}
+
+void ANetworkSweepRunner::BeginMeasuring()
+{
+	measuring = true;
+	samples = 0;
+	inBytesPerSecondSum = 0.0;
+	outBytesPerSecondSum = 0.0;
+	serverFrameMsSum = 0.0;
+	serverFrameMsMax = 0.f;
+
+	TArray<APlayerCharacter*> players;
+	GetPlayers(players);
+	for (APlayerCharacter* player : players)
+	{
+		// Client stats gathered during warmup are thrown away on the client, not sent
+		player->ResetNetSessionStats();
+		player->ClientFlushNetStats(true);
+	}
+}
+
+void ANetworkSweepRunner::EndMeasuring()
+{
+	measuring = false;
+	collecting = true;
+
+	serverTotals = FNetSessionStats{};
+	TArray<APlayerCharacter*> players;
+	GetPlayers(players);
+	for (APlayerCharacter* player : players)
+	{
+		const FNetSessionStats& stats = player->GetNetSessionStats();
+		serverTotals.movesReceived += stats.movesReceived;
+		serverTotals.shotsValidated += stats.shotsValidated;
+		serverTotals.serverHits += stats.serverHits;
+
+		// Ask for everything the client counted up to now, it arrives during the collect phase
+		player->ClientFlushNetStats(false);
+	}
+	measuredPlayers = players.Num();
+}
+
+void ANetworkSweepRunner::FinishProfile()
+{
+	FNetSweepResult result{};
+	result.Profile = Profiles[currentProfile];
+
+	FNetSessionStats total = serverTotals;
+	TArray<APlayerCharacter*> players;
+	GetPlayers(players);
+	for (APlayerCharacter* player : players)
+	{
+		total.AddClientStats(player->GetNetSessionStats());
+	}
+
+	result.NumPlayers = measuredPlayers;
+	result.AvgMispredictionError = total.corrections > 0 ? total.mispredictionErrorSum / total.corrections : 0.f;
+	result.MaxMispredictionError = total.mispredictionErrorMax;
+	result.CorrectionRate = total.acksReceived > 0 ? float(total.corrections) / total.acksReceived : 0.f;
+	result.HitRegAccuracy = total.shotsResolved > 0 ? float(total.shotsAgreed) / total.shotsResolved : 1.f;
+	result.MovesPerSecond = ProfileDuration > 0.f ? total.movesReceived / ProfileDuration : 0.f;
+	if (samples > 0)
+	{
+		result.AvgInKBps = inBytesPerSecondSum / samples / 1024.0;
+		result.AvgOutKBps = outBytesPerSecondSum / samples / 1024.0;
+		result.AvgServerFrameMs = serverFrameMsSum / samples;
+		result.MaxServerFrameMs = serverFrameMsMax;
+	}
+	Results.Add(result);
+
+	if (currentProfile + 1 < Profiles.Num())
+	{
+		BeginProfile(currentProfile + 1);
+	}
+	else
+	{
+		StopSweep();
+		WriteReport();
+	}
+}
+
+void ANetworkSweepRunner::ApplyProfile(const FNetEmulationProfile& profile)
+{
+#if DO_ENABLE_NET_TEST
+	UNetDriver* netDriver = GetWorld()->GetNetDriver();
+	if (!netDriver)
+	{
+		return;
+	}
+
+	for (UNetConnection* connection : netDriver->ClientConnections)
+	{
+		ApplyProfileToConnection(connection, profile);
+	}
+
+	// Server side settings only shape what the server sends and receives, clients shape their own traffic
+	TArray<APlayerCharacter*> players;
+	GetPlayers(players);
+	for (APlayerCharacter* player : players)
+	{
+		player->ClientSetNetEmulation(profile);
+	}
+#else
+	UE_LOG(LogTemp, Warning, TEXT("Network sweep: packet simulation is not available in this build"));
+#endif
+}
+
+void ANetworkSweepRunner::ApplyProfileToConnection(UNetConnection* connection, const FNetEmulationProfile& profile)
+{
+#if DO_ENABLE_NET_TEST
+	if (!connection)
+	{
+		return;
+	}
+
+	FPacketSimulationSettings& settings = connection->PacketSimulationSettings;
+	settings.PktLag = profile.PktLag;
+	settings.PktLagVariance = profile.PktLagVariance;
+	settings.PktLoss = profile.PktLoss;
+	settings.PktIncomingLoss = profile.PktIncomingLoss;
+	settings.PktDup = profile.PktDup;
+	settings.PktOrder = profile.PktOrder ? 1 : 0;
+	settings.PktJitter = profile.PktJitter;
+	settings.ValidateSettings();
+#endif
+}
+
+void ANetworkSweepRunner::SetScriptedSession(bool enabled)
+{
+	TArray<APlayerCharacter*> players;
+	GetPlayers(players);
+	for (APlayerCharacter* player : players)
+	{
+		player->ClientSetScriptedSession(enabled, ScriptedFireInterval);
+	}
+}
+
+void ANetworkSweepRunner::GetPlayers(TArray<APlayerCharacter*>& outPlayers) const
+{
+	for (APlayerCharacter* player : GetWorld()->GetSubsystem<UPlayerRegistrySubsystem>()->GetPlayers())
+	{
+		if (player->GetNetConnection())
+		{
+			outPlayers.Add(player);
+		}
+	}
+}
+
+void ANetworkSweepRunner::WriteReport() const
+{
+	FString report = TEXT("Profile,Lag,LagVariance,Loss,IncomingLoss,Dup,Order,Jitter,Players,AvgMispredictionError,MaxMispredictionError,CorrectionRate,HitRegAccuracy,MovesPerSecond,AvgInKBps,AvgOutKBps,AvgServerFrameMs,MaxServerFrameMs\n");
+	for (const FNetSweepResult& result : Results)
+	{
+		const FNetEmulationProfile& profile = result.Profile;
+		report += FString::Printf(TEXT("%s,%d,%d,%d,%d,%d,%d,%d,%d,%.3f,%.3f,%.4f,%.4f,%.1f,%.2f,%.2f,%.3f,%.3f\n"),
+			*profile.Name, profile.PktLag, profile.PktLagVariance, profile.PktLoss, profile.PktIncomingLoss, profile.PktDup, profile.PktOrder ? 1 : 0, profile.PktJitter,
+			result.NumPlayers, result.AvgMispredictionError, result.MaxMispredictionError, result.CorrectionRate, result.HitRegAccuracy,
+			result.MovesPerSecond, result.AvgInKBps, result.AvgOutKBps, result.AvgServerFrameMs, result.MaxServerFrameMs);
+
+		UE_LOG(LogTemp, Warning, TEXT("Network sweep '%s': error avg %.3f max %.3f, corrections %.1f%%, hit reg %.1f%%, in %.2f KB/s, out %.2f KB/s, frame %.3f ms"),
+			*profile.Name, result.AvgMispredictionError, result.MaxMispredictionError, result.CorrectionRate * 100.f, result.HitRegAccuracy * 100.f,
+			result.AvgInKBps, result.AvgOutKBps, result.AvgServerFrameMs);
+	}
+
+	FString fileName = FString::Printf(TEXT("Sweep_%s.csv"), *FDateTime::Now().ToString());
+	FString filePath = FPaths::Combine(FPaths::ProjectSavedDir(), ReportDirectory, fileName);
+	if (FFileHelper::SaveStringToFile(report, *filePath))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Network sweep report written to %s"), *filePath);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to write network sweep report to %s"), *filePath);
+	}
+}
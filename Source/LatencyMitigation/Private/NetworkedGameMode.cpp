@@ -8,12 +8,61 @@ void ANetworkedGameMode::PostLogin(APlayerController* NewPlayer)
 {
 	Super::PostLogin(NewPlayer);
 
+	FMatchInstance& match = FindOrCreateMatch();
+	match.Players.Add(NewPlayer);
 
+	TOptional<FLinearColor> color;
+	if (DefaultPlayerColors.Num() > 0)
+	{
+		color = DefaultPlayerColors[match.NextColorIndex % DefaultPlayerColors.Num()];
+		match.NextColorIndex++;
+	}
+
+	// The controller applies the match to every pawn it possesses, including ones spawned after a respawn
+	ANetworkedPlayerController* controller = Cast<ANetworkedPlayerController>(NewPlayer);
 	APlayerCharacter* pawn = Cast<APlayerCharacter>(NewPlayer->GetPawn());
-	if (pawn)
+	if (controller)
+	{
+		controller->SetMatch(match.MatchId, color);
+	}
+	else if (pawn)
 	{
-		pawn->SetPlayerColor(DefaultPlayerColors[playersConnected]);
-		playersConnected++;
+		pawn->SetMatchId(match.MatchId);
+		if (color.IsSet())
+		{
+			pawn->SetPlayerColor(color.GetValue());
+		}
 	}
-	playersList.Add(NewPlayer);
+}
+
+void ANetworkedGameMode::Logout(AController* Exiting)
+{
+	for (int32 i = 0; i < matches.Num(); ++i)
+	{
+		if (matches[i].Players.Remove(Cast<APlayerController>(Exiting)) > 0)
+		{
+			if (matches[i].Players.Num() == 0)
+			{
+				matches.RemoveAtSwap(i);
+			}
+			break;
+		}
+	}
+
+	Super::Logout(Exiting);
+}
+
+FMatchInstance& ANetworkedGameMode::FindOrCreateMatch()
+{
+	for (FMatchInstance& match : matches)
+	{
+		if (match.Players.Num() < MaxPlayersPerMatch)
+		{
+			return match;
+		}
+	}
+
+	FMatchInstance& match = matches.AddDefaulted_GetRef();
+	match.MatchId = nextMatchId++;
+	return match;
 }
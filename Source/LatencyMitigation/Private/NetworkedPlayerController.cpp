@@ -2,4 +2,116 @@
 
 
 #include "NetworkedPlayerController.h"
+#include "PlayerCharacter.h"
+#include "PlayerRegistrySubsystem.h"
+#include "Misc/CoreDelegates.h"
 
+ANetworkedPlayerController::ANetworkedPlayerController()
+{
+	SnapshotRateSettings.MinInterval = 0.033f;
+	SnapshotRateSettings.MaxInterval = 0.2f;
+	SnapshotRateSettings.InitialInterval = 0.1f;
+	SnapshotRateSettings.BandwidthTarget = 32000;
+	SnapshotRateSettings.MaxRedundancy = 0;
+}
+
+void ANetworkedPlayerController::BeginPlay()
+{
+	Super::BeginPlay();
+	snapshotRateController.Initialize(SnapshotRateSettings);
+}
+
+void ANetworkedPlayerController::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	FCoreDelegates::OnEndFrame.Remove(endFrameHandle);
+	latencyTracer.Reset();
+	Super::EndPlay(EndPlayReason);
+}
+
+void ANetworkedPlayerController::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// A listen server's own controller sees the server's actors directly
+	if (HasAuthority() && !IsLocalController() && snapshotRateController.Update(DeltaTime, GetNetConnection()))
+	{
+		SendSnapshots();
+	}
+}
+
+void ANetworkedPlayerController::SendSnapshots()
+{
+	APlayerCharacter* viewer = Cast<APlayerCharacter>(GetPawn());
+
+	UPlayerRegistrySubsystem* registry = GetWorld()->GetSubsystem<UPlayerRegistrySubsystem>();
+	double now = registry->GetServerWorldTimeSeconds();
+
+	TArray<FProxySnapshot> snapshots;
+	for (APlayerCharacter* player : registry->GetMatchPlayers(matchId))
+	{
+		if (player != viewer)
+		{
+			FPlayerMovementState state = player->GetMovementState();
+			FProxySnapshot& snapshot = snapshots.AddDefaulted_GetRef();
+			snapshot.player = player;
+			snapshot.timestamp = now;
+			snapshot.location = state.location;
+			snapshot.yaw = state.yaw;
+			snapshot.pitch = state.pitch;
+		}
+	}
+
+	if (snapshots.Num() > 0)
+	{
+		ClientReceiveSnapshots(snapshots);
+	}
+}
+
+FLatencyTracer* ANetworkedPlayerController::GetLatencyTracer()
+{
+	if (!latencyTracer && IsLocalController() && GetNetMode() == NM_Client)
+	{
+		latencyTracer = MakeUnique<FLatencyTracer>();
+		endFrameHandle = FCoreDelegates::OnEndFrame.AddUObject(this, &ANetworkedPlayerController::OnEndFrame);
+	}
+	return latencyTracer.Get();
+}
+
+void ANetworkedPlayerController::OnEndFrame()
+{
+	// Reconciled state has been handed to the renderer by the end of the game thread frame
+	latencyTracer->CompleteRenderedTraces();
+}
+
+void ANetworkedPlayerController::SetMatch(int32 newMatchId, TOptional<FLinearColor> newColor)
+{
+	matchId = newMatchId;
+	matchColor = newColor;
+	ApplyMatchTo(Cast<APlayerCharacter>(GetPawn()));
+}
+
+void ANetworkedPlayerController::ApplyMatchTo(APlayerCharacter* pawn) const
+{
+	if (!pawn)
+	{
+		return;
+	}
+
+	pawn->SetMatchId(matchId);
+	if (matchColor.IsSet())
+	{
+		pawn->SetPlayerColor(matchColor.GetValue());
+	}
+}
+
+void ANetworkedPlayerController::ClientReceiveSnapshots_Implementation(const TArray<FProxySnapshot>& snapshots)
+{
+	for (const FProxySnapshot& snapshot : snapshots)
+	{
+		// Null when the player is not replicated to this client (yet)
+		if (snapshot.player)
+		{
+			snapshot.player->ReceiveProxySnapshot(snapshot);
+		}
+	}
+}
@@ -1,10 +1,17 @@
 #include "PlayerCharacter.h"
 #include "NetworkedPlayerController.h"
 	#include "GameFramework/GameStateBase.h"
+#include "GameFramework/PlayerState.h"
+#include "ServerShotProcessor.h"
+#include "Algo/BinarySearch.h"
+#include "Framework/Application/SlateApplication.h"
+#include "GameFramework/PlayerInput.h"
+#include "GameFramework/InputSettings.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/LocalPlayer.h"
 
 // Sets default values
 APlayerCharacter::APlayerCharacter() :
-	serverMovesToApply{},
 	nonAckedMoves{},
 	serverPositionsToSimulate{}
 {
@@ -32,7 +39,31 @@ APlayerCharacter::APlayerCharacter() :
 	Collider->SetCapsuleSize(25.0f, 50.0f);
 	Collider->SetRelativeLocation(FVector(0.f, 0.f, 50.0f));
 
+	FHitboxShape torso{};
+	torso.Name = TEXT("Torso");
+	torso.LocalOffset = FVector(0.f, 0.f, 40.f);
+	torso.Radius = 25.f;
+	torso.HalfHeight = 15.f;
+	Hitboxes.Add(torso);
+
+	FHitboxShape head{};
+	head.Name = TEXT("Head");
+	head.LocalOffset = FVector(0.f, 0.f, 85.f);
+	head.Radius = 15.f;
+	Hitboxes.Add(head);
+
 	
+	MoveRateSettings.MinInterval = 0.f;
+	MoveRateSettings.MaxInterval = 0.05f;
+	MoveRateSettings.InitialInterval = 0.f;
+	MoveRateSettings.BandwidthTarget = 8000;
+
+	AckRateSettings.MinInterval = 0.033f;
+	AckRateSettings.MaxInterval = 0.2f;
+	AckRateSettings.InitialInterval = 0.1f;
+	AckRateSettings.BandwidthTarget = 16000;
+	AckRateSettings.MaxRedundancy = 0;
+
 	SetReplicates(true);
 	SetReplicateMovement(false);
 }
@@ -45,15 +76,46 @@ void APlayerCharacter::BeginPlay()
 	{
 		UpdateWidget_ClientInfo(GetActorLocation());
 	}
-	Collider->GetScaledCapsuleSize(radius, halfHeight);
+	moveRateController.Initialize(MoveRateSettings);
+	ackRateController.Initialize(AckRateSettings);
+	telemetry = GetWorld()->GetSubsystem<UTelemetrySubsystem>();
+	registry = GetWorld()->GetSubsystem<UPlayerRegistrySubsystem>();
+	registrySlot = registry->Register(this);
+	// The controller may have set the match on possession before the pawn was registered
+	registry->SetPlayerMatch(registrySlot, matchId);
 	GetNetworkEmulationSettings();
 }
 
+void APlayerCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (registry)
+	{
+		registry->Unregister(registrySlot);
+		registrySlot = INDEX_NONE;
+	}
+	if (mouseProcessor && FSlateApplication::IsInitialized())
+	{
+		FSlateApplication::Get().UnregisterInputPreProcessor(mouseProcessor);
+	}
+	mouseProcessor.Reset();
+	Super::EndPlay(EndPlayReason);
+}
+
 // Called every frame
 void APlayerCharacter::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
+	if (scriptedSession && GetLocalRole() == ROLE_AutonomousProxy)
+	{
+		timeSinceScriptedFire += DeltaTime;
+		if (scriptedFireInterval > 0.f && timeSinceScriptedFire >= scriptedFireInterval)
+		{
+			timeSinceScriptedFire = 0.f;
+			Fire();
+		}
+	}
+
 	if (dummy)
 	{
 		if (dummyMovementTime >= TotalDummyMoveTime)
@@ -79,74 +141,70 @@ void APlayerCharacter::Tick(float DeltaTime)
 
 		UpdateWidget_ClientInfo(GetActorLocation());
 
-
-		if (bMovementToSend)
+		// Scripted sessions report only when the sweep asks, so every report lands in the right window
+		netStatsReportCounter += DeltaTime;
+		if (!scriptedSession && netStatsReportCounter >= NetStatsReportInterval)
 		{
-			bMovementToSend = false;
-			FPlayerMove currentMove{};
-			if (bMoveOnForwardAxis)
+			netStatsReportCounter = 0.f;
+			if (clientNetStats.acksReceived > 0 || clientNetStats.shotsResolved > 0)
 			{
-				currentMove.forwardAxis = forwardAxis;
-				bMoveOnForwardAxis = false;
-				forwardAxis = 0.f;
+				ServerReportNetStats(clientNetStats);
+				clientNetStats = FNetSessionStats{};
 			}
+		}
 
-			if (bMoveOnRightAxis)
-			{
-				currentMove.rightAxis = rightAxis;
-				bMoveOnRightAxis = false;
-				rightAxis = 0.f;
-			}
+		latencyReportCounter += DeltaTime;
+		if (latencyReportCounter >= LatencyReportInterval)
+		{
+			latencyReportCounter = 0.f;
+			ReportLatencyStages();
+		}
 
-			if (bMoveLookAt)
+		// Input from the whole frame is in by now, turn it into a single move
+		FlushInputToMove();
+
+		// Moves are predicted every frame but only uploaded at the rate the connection can take
+		if (moveRateController.Update(DeltaTime, GetNetConnection()))
+		{
+			if (nextMoveId - 1 > lastSentMoveId)
 			{
-				currentMove.lookAtRotation = lookAtAxis;
-				bMoveLookAt = false;
-				lookAtAxis = 0.f;
+				SendPendingMoves();
 			}
-
-			if (bMovePlayerRot)
+			else if (ShouldResendMoves())
 			{
-				currentMove.playerRotation = playerRotAxis;
-				bMovePlayerRot = false;
-				playerRotAxis = 0.f;
+				SendPendingMoves(true);
 			}
-
-			auto gameState = UGameplayStatics::GetGameState(GetWorld());
-			currentMove.timestamp = gameState->GetServerWorldTimeSeconds();
-			currentMove.moveID = nextMoveId++;
-			ServerMove(currentMove);
-			ApplyMovement(currentMove);
-			nonAckedMoves.push(currentMove);
-
-
-			UpdateWidget_SentMoves(currentMove.moveID);
-
 		}
 	}
 	else if (GetLocalRole() == ROLE_Authority)
 	{
-		serverUpdateCounter += DeltaTime;
-		if (serverUpdateCounter >= 0.1f)
+		if (ackRateController.Update(DeltaTime, GetNetConnection()))
 		{
+			if (serverTraceId != 0 && serverTraceApplyTime > 0.0)
+			{
+				nextServerUpdate.traceID = serverTraceId;
+				nextServerUpdate.serverReceiveToApplyMs = (serverTraceApplyTime - serverTraceReceiveTime) * 1000.0;
+				nextServerUpdate.serverApplyToAckMs = (FPlatformTime::Seconds() - serverTraceApplyTime) * 1000.0;
+				serverTraceId = 0;
+			}
+			else
+			{
+				nextServerUpdate.traceID = 0;
+			}
+
 			if (!freshPlayerInput)
 			{
 				nextServerUpdate.moveID = 0;
+				nextServerUpdate.timestamp = registry->GetServerWorldTimeSeconds();
 				nextServerUpdate.playerLocation = GetActorLocation();
 				nextServerUpdate.playerRotation = GetActorRotation().Yaw;
 				nextServerUpdate.lookAtRotation = PlayerCamera->GetComponentRotation().Pitch;
-				if (rollbackPositions.size() < numRollbackPositions)
-				{
-					rollbackPositions.push_back(nextServerUpdate);
-				}
-				else
-				{
-					rollbackPositions.pop_front();
-					rollbackPositions.push_back(nextServerUpdate);
-				}
+				RecordServerUpdate();
+			}
+			if (GetNetConnection())
+			{
+				ClientAckMove(nextServerUpdate);
 			}
-			MulticastReconcileMove(nextServerUpdate);
-			serverUpdateCounter = 0.f;
 			freshPlayerInput = false;
 		}
 	}
@@ -156,12 +214,15 @@ void APlayerCharacter::Tick(float DeltaTime)
 		{
 			if (!serverPositionsToSimulate.empty())
 			{
+				// Snapshot rate varies per connection so interpolate over the real gap between snapshots
+				const FServerMoveAck& newerState = serverPositionsToSimulate.front();
+				float snapshotInterval = FMath::Max(float(newerState.timestamp - oldestServerState.timestamp), 0.01f);
 				simulatedUpdateCounter += DeltaTime;
-				FVector NewLocation = FMath::Lerp(oldestServerPosition, serverPositionsToSimulate.front(), simulatedUpdateCounter / 0.1f);
+				FVector NewLocation = FMath::Lerp(oldestServerState.playerLocation, newerState.playerLocation, FMath::Min(simulatedUpdateCounter / snapshotInterval, 1.f));
 
-				if (simulatedUpdateCounter > 0.1f)
+				if (simulatedUpdateCounter > snapshotInterval)
 				{
-					oldestServerPosition = serverPositionsToSimulate.front();
+					oldestServerState = newerState;
 					serverPositionsToSimulate.pop();
 					simulatedUpdateCounter = 0.f;
 				}
@@ -184,6 +245,90 @@ void APlayerCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputCom
 	PlayerInputComponent->BindAxis("LookUp", this, &APlayerCharacter::LookUp);
 	PlayerInputComponent->BindAction("Fire", IE_Pressed, this, &APlayerCharacter::Fire);
 	PlayerInputComponent->BindAction("Dummy", IE_Pressed, this, &APlayerCharacter::ToggleDummy);
+
+	// Look input is read per mouse event instead of from the summed Turn/LookUp axes
+	APlayerController* playerController = Cast<APlayerController>(GetController());
+	if (!mouseProcessor && GetLocalRole() == ROLE_AutonomousProxy && FSlateApplication::IsInitialized() && playerController && playerController->GetLocalPlayer())
+	{
+		mouseProcessor = MakeShared<FMouseInputProcessor>(playerController->GetLocalPlayer()->ViewportClient);
+		FSlateApplication::Get().RegisterInputPreProcessor(mouseProcessor);
+	}
+}
+
+void APlayerCharacter::FlushInputToMove()
+{
+	AddMouseSamples();
+	if (!inputSampler.HasSamples())
+	{
+		return;
+	}
+
+	FPlayerMove currentMove{};
+	if (TraceEveryNthMove > 0 && ++movesSinceTrace >= uint32(TraceEveryNthMove))
+	{
+		movesSinceTrace = 0;
+		FLatencyTracer* latencyTracer = GetLatencyTracer();
+		currentMove.traceID = latencyTracer ? latencyTracer->BeginTrace(inputSampler.GetFirstSampleTime()) : 0;
+	}
+	inputSampler.Flush(currentMove);
+	currentMove.timestamp = registry->GetServerWorldTimeSeconds();
+	currentMove.moveID = nextMoveId++;
+	ApplyMovement(currentMove);
+	nonAckedMoves.push_back(currentMove);
+}
+
+void APlayerCharacter::AddMouseSamples()
+{
+	APlayerController* playerController = Cast<APlayerController>(GetController());
+	if (!mouseProcessor || !playerController || !playerController->PlayerInput)
+	{
+		return;
+	}
+
+	// The viewport reports Y down while the MouseY key is positive up
+	float scaleX = GetMouseAxisScale(playerController, TEXT("Turn"), EKeys::MouseX);
+	float scaleY = -GetMouseAxisScale(playerController, TEXT("LookUp"), EKeys::MouseY);
+	for (const FMouseSample& sample : mouseProcessor->TakeSamples())
+	{
+		if (sample.delta.X != 0.0)
+		{
+			inputSampler.AddSample(EInputSampleAxis::Turn, sample.delta.X * scaleX, sample.time);
+		}
+		if (sample.delta.Y != 0.0)
+		{
+			inputSampler.AddSample(EInputSampleAxis::LookUp, sample.delta.Y * scaleY, sample.time);
+		}
+	}
+}
+
+float APlayerCharacter::GetMouseAxisScale(APlayerController* playerController, FName axisName, const FKey& key) const
+{
+	// Everything UPlayerInput applies to a mouse key on its way into an axis: key sensitivity and invert,
+	// FOV scaling, the axis mapping scale and the axis invert
+	UPlayerInput* playerInput = playerController->PlayerInput;
+	float scale = key == EKeys::MouseX ? playerInput->GetMouseSensitivityX() : playerInput->GetMouseSensitivityY();
+	if (playerInput->GetInvertAxisKey(key))
+	{
+		scale = -scale;
+	}
+
+	const UInputSettings* inputSettings = GetDefault<UInputSettings>();
+	if (inputSettings->bEnableFOVScaling && playerController->PlayerCameraManager)
+	{
+		scale *= inputSettings->FOVScale * playerController->PlayerCameraManager->GetFOVAngle();
+	}
+
+	float mappingScale = 0.f;
+	for (const FInputAxisKeyMapping& mapping : playerInput->GetKeysForAxis(axisName))
+	{
+		if (mapping.Key == key)
+		{
+			mappingScale += mapping.Scale;
+		}
+	}
+	scale *= mappingScale;
+
+	return playerInput->GetInvertAxis(axisName) ? -scale : scale;
 }
 
 void APlayerCharacter::GetNetworkEmulationSettings()
@@ -221,87 +366,220 @@ void APlayerCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& Out
 	DOREPLIFETIME(APlayerCharacter, PlayerColor);
 }
 
-void APlayerCharacter::ApplyMovement(const FPlayerMove& move)
+FPlayerMovementState APlayerCharacter::SimulateMove(const FPlayerMovementState& state, const FPlayerMove& move, float movementSpeed, float turnSpeed)
 {
-	[[maybe_unused]] auto testPlayerRotationPre = GetActorRotation().Yaw;
-	[[maybe_unused]] auto testLookAtRotationPre = PlayerCamera->GetComponentRotation().Pitch;
-	AddActorLocalRotation(FRotator{ 0.f, TurnSpeed * move.playerRotation, 0.f });
-	PlayerCamera->AddLocalRotation(FRotator{ TurnSpeed * move.lookAtRotation, 0.f, 0.f });
-	[[maybe_unused]] auto testPlayerRotationPost = GetActorRotation().Yaw;
-	[[maybe_unused]] auto testLookAtRotationPost = PlayerCamera->GetComponentRotation().Pitch;
+	FPlayerMovementState newState = state;
+	newState.yaw = FRotator::NormalizeAxis(state.yaw + turnSpeed * move.playerRotation);
+	newState.pitch = FRotator::NormalizeAxis(state.pitch + turnSpeed * move.lookAtRotation);
 
-	FVector NewLocation = GetActorLocation();
+	FRotationMatrix rotation{ FRotator{ 0.f, newState.yaw, 0.f } };
 	if (move.forwardAxis != 0.f)
 	{
-		FVector ForwardVector = GetActorForwardVector();
-		NewLocation += (ForwardVector * MovementSpeed * move.forwardAxis);
+		newState.location += rotation.GetScaledAxis(EAxis::X) * movementSpeed * move.forwardAxis;
 	}
 
 	if (move.rightAxis != 0.f)
 	{
-		FVector RightVector = GetActorRightVector();
-		NewLocation += (RightVector * MovementSpeed * move.rightAxis);
+		newState.location += rotation.GetScaledAxis(EAxis::Y) * movementSpeed * move.rightAxis;
 	}
-	SetActorLocation(NewLocation);
+	return newState;
 }
 
-void APlayerCharacter::DrawCollider(const FVector& colliderPosition, const FColor& color)
+FPlayerMovementState APlayerCharacter::GetMovementState() const
 {
-	FVector CapsuleCenterLocal = FVector(0.0f, 0.0f, halfHeight);
+	return FPlayerMovementState{ GetActorLocation(), float(GetActorRotation().Yaw), float(PlayerCamera->GetRelativeRotation().Pitch) };
+}
 
-	// Convert the local center to world space by adding the component's location
-	FVector CapsuleCenterWorld = colliderPosition + CapsuleCenterLocal;
+void APlayerCharacter::SetMovementState(const FPlayerMovementState& state)
+{
+	SetActorLocationAndRotation(state.location, FRotator{ 0.f, state.yaw, 0.f });
+	PlayerCamera->SetRelativeRotation(FRotator{ state.pitch, 0.f, 0.f });
+}
 
-	DrawDebugCapsule(GetWorld(), CapsuleCenterWorld, halfHeight, radius, GetActorRotation().Quaternion(), color, false, 1.0f, 0, 1.0f);
+void APlayerCharacter::ApplyMovement(const FPlayerMove& move)
+{
+	SetMovementState(SimulateMove(GetMovementState(), move, MovementSpeed, TurnSpeed));
 }
 
-void APlayerCharacter::RewindPlayerPosition(double timestamp)
+void APlayerCharacter::SendPendingMoves(bool resendUnacked)
 {
-	if (GetLocalRole() == ROLE_Authority)
+	int32 numUnacked = nonAckedMoves.size();
+	int32 firstNew = numUnacked;
+	while (firstNew > 0 && nonAckedMoves[firstNew - 1].moveID > lastSentMoveId)
 	{
-		std::list<FServerMoveAck>::iterator prev;
-		for (auto it = rollbackPositions.begin(); it != rollbackPositions.end();  ++it)
+		--firstNew;
+	}
+
+	// Every new move has to go out, or every unacked one when resending after a lost packet
+	int32 firstRequired = resendUnacked ? 0 : firstNew;
+	int32 numRequired = numUnacked - firstRequired;
+	if (numRequired <= 0)
+	{
+		return;
+	}
+
+	// Already sent moves are repeated as redundancy only in the room left over, they never cost an extra RPC
+	int32 numPackets = FMath::DivideAndRoundUp(numRequired, MaxMovesPerPacket);
+	int32 redundancy = FMath::Min3(moveRateController.GetRedundancy(), firstRequired, numPackets * MaxMovesPerPacket - numRequired);
+	int32 firstMove = firstRequired - redundancy;
+
+	FLatencyTracer* latencyTracer = GetLatencyTracer();
+	for (int32 packetStart = firstMove; packetStart < numUnacked; packetStart += MaxMovesPerPacket)
+	{
+		int32 packetEnd = FMath::Min(packetStart + MaxMovesPerPacket, numUnacked);
+		TArray<FPlayerMove> moves;
+		moves.Reserve(packetEnd - packetStart);
+		for (int32 i = packetStart; i < packetEnd; ++i)
 		{
-			if (timestamp > it->timestamp)
+			moves.Add(nonAckedMoves[i]);
+			if (latencyTracer && nonAckedMoves[i].traceID != 0)
 			{
-				continue;
+				latencyTracer->MarkSent(nonAckedMoves[i].traceID);
 			}
-			else
-			{
-				prev = --it;
-				it++;
+		}
+		ServerMove(moves);
+	}
 
-				auto olderTimeStamp = prev->timestamp;
-				auto newerTimeStamp = it->timestamp;
+	lastSentMoveId = nonAckedMoves.back().moveID;
+	lastMoveSendTime = FPlatformTime::Seconds();
+	UpdateWidget_SentMoves(lastSentMoveId);
+}
 
-				auto alpha = (timestamp - prev->timestamp) / (it->timestamp - prev->timestamp);
-				cachedRollbackPosition = GetActorLocation();
-				SetActorLocation(FMath::Lerp(prev->playerLocation, it->playerLocation, alpha));
-				rolledBack = true;
-				break;
-			}
+bool APlayerCharacter::ShouldResendMoves() const
+{
+	if (nonAckedMoves.empty())
+	{
+		return false;
+	}
+
+	// Nothing new to send but moves are still unacked, so the last packet or its ack may have been lost.
+	// Resend once the oldest has waited a round trip, and at most once per round trip.
+	float resendAfter = FMath::Max(moveRateController.GetSmoothedRtt(), moveRateController.GetSendInterval());
+	return registry->GetServerWorldTimeSeconds() - nonAckedMoves.front().timestamp > resendAfter
+		&& FPlatformTime::Seconds() - lastMoveSendTime > resendAfter;
+}
+
+void APlayerCharacter::RecordServerUpdate()
+{
+	rollbackHistory.Append(nextServerUpdate.timestamp, nextServerUpdate.playerLocation, nextServerUpdate.playerRotation, nextServerUpdate.lookAtRotation);
+	rollbackHistory.Trim(nextServerUpdate.timestamp - RollbackWindow * rollbackWindowScale);
+}
+
+void APlayerCharacter::RecordTelemetry(ETelemetrySeries series, float value)
+{
+	if (telemetry)
+	{
+		APlayerState* playerState = GetPlayerState();
+		telemetry->Record(series, playerState ? playerState->GetPlayerId() : 0, value);
+	}
+}
+
+FLatencyTracer* APlayerCharacter::GetLatencyTracer() const
+{
+	ANetworkedPlayerController* controller = Cast<ANetworkedPlayerController>(GetController());
+	return controller ? controller->GetLatencyTracer() : nullptr;
+}
+
+void APlayerCharacter::ReportLatencyStages()
+{
+	FLatencyTracer* latencyTracer = GetLatencyTracer();
+	if (!latencyTracer)
+	{
+		return;
+	}
+
+	latencyTracer->PublishStats();
+	TArray<FLatencyStageSummary> stages;
+	latencyTracer->GetSummaries(stages);
+	UpdateWidget_LatencyStages(stages);
+	latencyTracer->ResetHistograms();
+}
+
+void APlayerCharacter::DrawCollider(const FHitboxPose& pose, const FColor& color)
+{
+	FQuat rotation = FRotator{ 0.f, pose.yaw, 0.f }.Quaternion();
+	for (const FHitboxShape& shape : Hitboxes)
+	{
+		FVector center = pose.location + rotation.RotateVector(shape.LocalOffset);
+		if (shape.HalfHeight > 0.f)
+		{
+			DrawDebugCapsule(GetWorld(), center, shape.HalfHeight + shape.Radius, shape.Radius, rotation, color, false, 1.0f, 0, 1.0f);
+		}
+		else
+		{
+			DrawDebugSphere(GetWorld(), center, shape.Radius, 12, color, false, 1.0f, 0, 1.0f);
 		}
 	}
-	
 }
 
-void APlayerCharacter::RestorePlayerPosition()
+FHitboxPose APlayerCharacter::GetCurrentPose() const
+{
+	return FHitboxPose{ GetActorLocation(), float(GetActorRotation().Yaw) };
+}
+
+FHitboxPose APlayerCharacter::GetHistoricalPose(double timestamp) const
+{
+	FHitboxPose pose = GetCurrentPose();
+	SampleHistoricalPose(timestamp, pose);
+	return pose;
+}
+
+bool APlayerCharacter::SampleHistoricalPose(double timestamp, FHitboxPose& outPose) const
+{
+	// Read only, called from shot validation workers while the game thread waits
+	FRollbackSample sample;
+	if (timestamp >= rollbackHistory.GetNewestTimestamp() || !rollbackHistory.Sample(timestamp, sample))
+	{
+		return false;
+	}
+	outPose = FHitboxPose{ sample.location, sample.yaw };
+	return true;
+}
+
+void APlayerCharacter::GetShotRay(FVector& outStart, FVector& outEnd) const
 {
-	if (GetLocalRole() == ROLE_Authority && rolledBack)
+	outStart = PlayerCamera->GetComponentLocation();
+	outEnd = outStart + (PlayerCamera->GetComponentRotation().Vector() * ShotRange);
+}
+
+FVector APlayerCharacter::TraceLevel(const FVector& StartVector, const FVector& EndVector) const
+{
+	// Level geometry can still block the shot, players of every match are only tested through their hitboxes
+	FCollisionQueryParams Params;
+	for (APlayerCharacter* player : registry->GetPlayers())
+	{
+		Params.AddIgnoredActor(player);
+	}
+
+	FHitResult hitResult;
+	if (GetWorld()->LineTraceSingleByChannel(hitResult, StartVector, EndVector, ECC_Visibility, Params))
 	{
-		rolledBack = false;
-		SetActorLocation(cachedRollbackPosition);
+		return hitResult.Location;
 	}
+	return EndVector;
 }
 
+APlayerCharacter* APlayerCharacter::TraceShot(FVector StartVector, FVector EndVector) const
+{
+	const TArray<APlayerCharacter*>& players = registry->GetMatchPlayers(matchId);
+	FHitboxQuery query{ StartVector, TraceLevel(StartVector, EndVector) };
+	for (int32 i = 0; i < players.Num(); ++i)
+	{
+		if (players[i] != this)
+		{
+			query.AddShapes(players[i]->Hitboxes, players[i]->GetCurrentPose(), i);
+		}
+	}
+
+	FHitboxHit hit;
+	return query.Raycast(hit) ? players[hit.owner] : nullptr;
+}
 
 void APlayerCharacter::MoveForward(float Axis)
 {
 	if (Axis != 0.f)
 	{
-		bMovementToSend = true;
-		bMoveOnForwardAxis = true;
-		forwardAxis = Axis;
+		inputSampler.AddSample(EInputSampleAxis::Forward, Axis);
 	}
 }
 
@@ -309,44 +587,62 @@ void APlayerCharacter::MoveRight(float Axis)
 {
 	if (Axis != 0.f)
 	{
-		bMovementToSend = true;
-		bMoveOnRightAxis = true;
-		rightAxis = Axis;
+		inputSampler.AddSample(EInputSampleAxis::Right, Axis);
 	}
 }
 
 void APlayerCharacter::Turn(float Axis)
 {
-	if (Axis != 0.f)
+	// Turn and LookUp are mouse only, with the processor registered the same motion is already sampled per event
+	if (Axis != 0.f && !mouseProcessor)
 	{
-		bMovementToSend = true;
-		bMovePlayerRot = true;
-		playerRotAxis = Axis;
+		inputSampler.AddSample(EInputSampleAxis::Turn, Axis);
 	}
 }
 
 void APlayerCharacter::LookUp(float Axis)
 {
-	if (Axis != 0.f)
+	if (Axis != 0.f && !mouseProcessor)
 	{
-		bMovementToSend = true;
-		bMoveLookAt = true;
-		lookAtAxis = Axis;
+		inputSampler.AddSample(EInputSampleAxis::LookUp, Axis);
 	}
 }
 
 void APlayerCharacter::Fire()
 {
-	ServerFire(UGameplayStatics::GetGameState(GetWorld())->GetServerWorldTimeSeconds());
+	// The aim the shot was fired with has to reach the server with it, not a send interval later
+	FlushInputToMove();
+	if (nextMoveId - 1 > lastSentMoveId)
+	{
+		SendPendingMoves();
+	}
+
+	double shotTimestamp = registry->GetServerWorldTimeSeconds();
+	FVector StartVector, EndVector;
+	GetShotRay(StartVector, EndVector);
+	FLatencyTracer* latencyTracer = GetLatencyTracer();
+	uint32 traceID = latencyTracer ? latencyTracer->BeginTrace(FPlatformTime::Seconds()) : 0;
+	ServerFire(shotTimestamp, traceID, lastSentMoveId);
+	if (latencyTracer)
+	{
+		latencyTracer->MarkSent(traceID);
+	}
+
+	// Remember what the shot looked like on our screen so the server verdict can be scored against it
+	bool predictedHit = TraceShot(StartVector, EndVector) != nullptr;
+	pendingShotPredictions.RemoveAll([shotTimestamp](const TPair<double, bool>& prediction)
+		{
+			return shotTimestamp - prediction.Key > 2.0;
+		});
+	pendingShotPredictions.Emplace(shotTimestamp, predictedHit);
+
 	if (DrawDebug)
 	{
-		TArray<AActor*> FoundActors;
-		UGameplayStatics::GetAllActorsOfClass(GetWorld(), APlayerCharacter::StaticClass(), FoundActors);
-		for (auto foundActor : FoundActors)
+		for (APlayerCharacter* otherPlayer : registry->GetMatchPlayers(matchId))
 		{
-			if (!(foundActor == this))
+			if (otherPlayer != this)
 			{
-				DrawCollider(foundActor->GetActorLocation(), FColor::Blue);
+				DrawCollider(otherPlayer->GetCurrentPose(), FColor::Blue);
 			}
 		}
 	}
@@ -358,9 +654,45 @@ void APlayerCharacter::ToggleDummy()
 	dummyMovementTime = TotalDummyMoveTime / 2;
 }
 
+void APlayerCharacter::ClientSetScriptedSession_Implementation(bool enabled, float fireInterval)
+{
+	scriptedSession = enabled;
+	scriptedFireInterval = fireInterval;
+	timeSinceScriptedFire = 0.f;
+	if (dummy != enabled)
+	{
+		ToggleDummy();
+	}
+}
+
+void APlayerCharacter::ClientFlushNetStats_Implementation(bool discard)
+{
+	if (!discard && (clientNetStats.acksReceived > 0 || clientNetStats.shotsResolved > 0))
+	{
+		ServerReportNetStats(clientNetStats);
+	}
+	clientNetStats = FNetSessionStats{};
+	netStatsReportCounter = 0.f;
+}
+
+void APlayerCharacter::ClientSetNetEmulation_Implementation(FNetEmulationProfile profile)
+{
+	ANetworkSweepRunner::ApplyProfileToConnection(GetNetConnection(), profile);
+}
+
+void APlayerCharacter::ServerReportNetStats_Implementation(FNetSessionStats clientStats)
+{
+	netStats.AddClientStats(clientStats);
+}
+
+void APlayerCharacter::ResetNetSessionStats()
+{
+	netStats = FNetSessionStats{};
+}
+
 void APlayerCharacter::ClientDebugResponse_Implementation(FServerDrawDebug debugInfo)
 {
-	DrawCollider(debugInfo.OtherPlayerLocation, debugInfo.DrawColor);
+	DrawCollider(FHitboxPose{ debugInfo.OtherPlayerLocation, debugInfo.OtherPlayerYaw }, debugInfo.DrawColor);
 }
 
 void APlayerCharacter::OnRep_PlayerColor()
@@ -371,90 +703,182 @@ void APlayerCharacter::OnRep_PlayerColor()
 	PlayerMesh->SetMaterial(0, newMaterialInstance);
 }
 
-void APlayerCharacter::ServerMove_Implementation(FPlayerMove input)
+void APlayerCharacter::ServerMove_Implementation(const TArray<FPlayerMove>& moves)
 {
-	ApplyMovement(input);
-	
-	freshPlayerInput = true;
-	nextServerUpdate.moveID = input.moveID;
-	nextServerUpdate.timestamp = UGameplayStatics::GetGameState(GetWorld())->GetServerWorldTimeSeconds();
-	nextServerUpdate.playerLocation = GetActorLocation();
-	nextServerUpdate.playerRotation = GetActorRotation().Yaw;
-	nextServerUpdate.lookAtRotation = PlayerCamera->GetComponentRotation().Pitch;
+	if (moves.Num() > MaxMovesPerPacket)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Ignoring ServerMove with %d moves from %s, the limit is %d"), moves.Num(), *GetName(), MaxMovesPerPacket);
+		return;
+	}
 
-	if (rollbackPositions.size() < numRollbackPositions)
+	// Redundant copies are skipped by move id, moves from a reordered packet are slotted in by id while still pending
+	for (const FPlayerMove& input : moves)
 	{
-		rollbackPositions.push_back(nextServerUpdate);
+		// Moves older than the last applied one cannot be applied any more, the client's reconcile corrects for them
+		if (input.moveID <= lastAppliedMoveId)
+		{
+			continue;
+		}
+
+		int32 index = Algo::LowerBoundBy(pendingServerMoves, input.moveID, [](const FPlayerMove& move) { return move.moveID; });
+		if (pendingServerMoves.IsValidIndex(index) && pendingServerMoves[index].moveID == input.moveID)
+		{
+			continue;
+		}
+
+		// A full queue still takes moves that fill a gap, at the cost of the newest pending one
+		if (pendingServerMoves.Num() >= MaxPendingServerMoves)
+		{
+			if (index == pendingServerMoves.Num())
+			{
+				continue;
+			}
+			pendingServerMoves.Pop(false);
+		}
+
+		if (pendingServerMoves.Num() == 0)
+		{
+			pendingMovesSince = FPlatformTime::Seconds();
+		}
+		if (input.traceID != 0 && serverTraceId == 0)
+		{
+			serverTraceId = input.traceID;
+			serverTraceReceiveTime = FPlatformTime::Seconds();
+			serverTraceApplyTime = 0.0;
+		}
+		pendingServerMoves.Insert(input, index);
 	}
-	else
+}
+
+bool APlayerCharacter::HasPendingServerMoves() const
+{
+	if (pendingServerMoves.Num() == 0)
 	{
-		rollbackPositions.pop_front();
-		rollbackPositions.push_back(nextServerUpdate);
+		return false;
 	}
+
+	// A gap means an older packet may still be on its way, give it a moment so moves are applied in order
+	bool gap = pendingServerMoves[0].moveID != lastAppliedMoveId + 1;
+	return !gap || FPlatformTime::Seconds() - pendingMovesSince >= MoveGapHoldTime;
 }
 
-void APlayerCharacter::ServerFire_Implementation(double timestamp)
+void APlayerCharacter::CommitServerMoves(const FPlayerMovementState& state, uint32 lastMoveId, int32 numMoves)
 {
-	FVector StartVector = PlayerCamera->GetComponentLocation();
-	FVector EndVector = StartVector + (PlayerCamera->GetComponentRotation().Vector() * ShotRange);
+	SetMovementState(state);
+	lastAppliedMoveId = lastMoveId;
+	netStats.movesReceived += numMoves;
+	if (serverTraceId != 0 && serverTraceApplyTime == 0.0)
+	{
+		serverTraceApplyTime = FPlatformTime::Seconds();
+	}
 
-	FHitResult hitResult;
-	FCollisionQueryParams Params;
-	Params.AddIgnoredActor(this);
+	freshPlayerInput = true;
+	nextServerUpdate.moveID = lastMoveId;
+	nextServerUpdate.timestamp = registry->GetServerWorldTimeSeconds();
+	nextServerUpdate.playerLocation = state.location;
+	nextServerUpdate.playerRotation = state.yaw;
+	nextServerUpdate.lookAtRotation = state.pitch;
+	RecordServerUpdate();
+}
 
-	bool hitAnotherPlayer = false;
-	
+void APlayerCharacter::ServerFire_Implementation(double timestamp, uint32 traceID, uint32 moveID)
+{
+	FPendingShot shot{};
+	shot.timestamp = timestamp;
+	shot.traceID = traceID;
+	shot.moveID = moveID;
+	shot.receiveTime = FPlatformTime::Seconds();
+	lastServerFireTime = registry->GetServerWorldTimeSeconds();
+
+	// Validated in one batch with every other shot after this frame's moves are applied and actors tick
+	GetWorld()->GetSubsystem<UServerShotProcessor>()->QueueShot(this, shot);
+}
 
+void APlayerCharacter::CommitShot(const FPendingShot& shot, APlayerCharacter* hitPlayer, const TArray<APlayerCharacter*>& targets, const TArray<FHitboxPose>& rewoundPoses)
+{
+	double timestamp = shot.timestamp;
+	FVector StartVector = shot.start;
+	FVector EndVector = shot.end;
 
-	auto playerArray = UGameplayStatics::GetGameState(GetWorld())->PlayerArray;
-	for (auto playerState : playerArray)
-	{
-		auto otherPlayerPawn = Cast<APlayerCharacter>(playerState->GetPawn());
-		if (otherPlayerPawn != this)
-		{
-			otherPlayerPawn->RewindPlayerPosition(timestamp);
-		}
-	}
+	bool hitAnotherPlayer = false;
 
-	APlayerCharacter* hitPlayer = nullptr;
-	if (GetWorld()->LineTraceSingleByChannel(hitResult, StartVector, EndVector, ECC_Visibility, Params))
+	if (hitPlayer)
 	{
-		auto hitActor = hitResult.GetActor();
-		if (hitActor)
-		{
-			hitPlayer = Cast<APlayerCharacter>(hitActor);
-			if (hitPlayer)
-			{
-				hitPlayer->ClientHitResponse();
-				hitAnotherPlayer = true;
-			}
-		}
+		hitPlayer->ClientHitResponse();
+		hitPlayer->lastServerHitTime = registry->GetServerWorldTimeSeconds();
+		hitAnotherPlayer = true;
 	}
+	double validateTime = FPlatformTime::Seconds();
 
 	FServerDrawDebug debugInfo{};
-	for (auto playerState : playerArray)
+	for (int32 i = 0; i < targets.Num(); ++i)
 	{
-		auto otherPlayerPawn = Cast<APlayerCharacter>(playerState->GetPawn());
-		if (otherPlayerPawn != this)
-		{
-			debugInfo.OtherPlayerLocation = otherPlayerPawn->GetActorLocation();
-			debugInfo.DrawColor = hitPlayer == otherPlayerPawn ? FColor::Green : FColor::Red;
-			otherPlayerPawn->RestorePlayerPosition();
-		}
+		debugInfo.OtherPlayerLocation = rewoundPoses[i].location;
+		debugInfo.OtherPlayerYaw = rewoundPoses[i].yaw;
+		debugInfo.DrawColor = hitPlayer == targets[i] ? FColor::Green : FColor::Red;
 	}
 
 	FServerFireAck ack{};
 	ack.hitPlayer = hitAnotherPlayer;
 	ack.StartRay = StartVector;
 	ack.EndRay = EndVector;
+	ack.shotTimestamp = timestamp;
+	netStats.shotsValidated++;
+	netStats.serverHits += hitAnotherPlayer ? 1 : 0;
+	RecordTelemetry(ETelemetrySeries::RewindAge, registry->GetServerWorldTimeSeconds() - timestamp);
+	RecordTelemetry(ETelemetrySeries::HitOutcome, hitAnotherPlayer ? 1.f : 0.f);
+	ack.traceID = shot.traceID;
+	ack.serverReceiveToApplyMs = (validateTime - shot.receiveTime) * 1000.0;
+	ack.serverApplyToAckMs = (FPlatformTime::Seconds() - validateTime) * 1000.0;
 	ClientFireResponse(ack);
 	ClientDebugResponse(debugInfo);
+}
 
-	
+void APlayerCharacter::RejectShot(const FPendingShot& shot)
+{
+	FServerFireAck ack{};
+	ack.rejected = true;
+	ack.StartRay = shot.start;
+	ack.EndRay = shot.end;
+	ack.shotTimestamp = shot.timestamp;
+	ClientFireResponse(ack);
+}
+
+bool APlayerCharacter::CanRewindTo(double timestamp) const
+{
+	// History older than the current, possibly shrunk, window is gone and the shot would be tested against the wrong pose
+	return registry->GetServerWorldTimeSeconds() - timestamp <= RollbackWindow * rollbackWindowScale;
 }
 
 void APlayerCharacter::ClientFireResponse_Implementation(FServerFireAck ack)
 {
+	FLatencyTracer* latencyTracer = GetLatencyTracer();
+	if (latencyTracer)
+	{
+		latencyTracer->MarkReceived(ack.traceID, ack.serverReceiveToApplyMs, ack.serverApplyToAckMs);
+	}
+
+	int32 predictionIndex = pendingShotPredictions.IndexOfByPredicate([&ack](const TPair<double, bool>& prediction)
+		{
+			return prediction.Key == ack.shotTimestamp;
+		});
+	if (ack.rejected)
+	{
+		// Never validated, so there is no verdict to score the prediction against
+		if (predictionIndex != INDEX_NONE)
+		{
+			pendingShotPredictions.RemoveAt(predictionIndex);
+		}
+		return;
+	}
+
+	if (predictionIndex != INDEX_NONE)
+	{
+		clientNetStats.shotsResolved++;
+		clientNetStats.shotsAgreed += pendingShotPredictions[predictionIndex].Value == ack.hitPlayer ? 1 : 0;
+		pendingShotPredictions.RemoveAt(predictionIndex);
+	}
+
 	if (ack.hitPlayer)
 	{
 		UpdateWidget_LandedHit();
@@ -467,6 +891,10 @@ void APlayerCharacter::ClientFireResponse_Implementation(FServerFireAck ack)
 	{
 		DrawDebugLine(GetWorld(), ack.StartRay, ack.EndRay, FColor::Red, false, 2.0f, 0, 1.0f);
 	}
+	if (latencyTracer)
+	{
+		latencyTracer->MarkReconciled(ack.traceID);
+	}
 }
 
 void APlayerCharacter::ClientHitResponse_Implementation()
@@ -474,50 +902,94 @@ void APlayerCharacter::ClientHitResponse_Implementation()
 	UpdateWidget_GotHit();
 }
 
-void APlayerCharacter::MulticastReconcileMove_Implementation(FServerMoveAck ack)
+void APlayerCharacter::ClientAckMove_Implementation(FServerMoveAck ack)
 {
-	auto role = GetLocalRole();
-	if (role == ROLE_AutonomousProxy)
+	FLatencyTracer* latencyTracer = GetLatencyTracer();
+	if (latencyTracer && ack.traceID != 0)
 	{
-		if (ack.moveID != 0)
+		latencyTracer->MarkReceived(ack.traceID, ack.serverReceiveToApplyMs, ack.serverApplyToAckMs);
+	}
+
+	if (ack.moveID != 0)
+	{
+		// Acks are unreliable, a stale one can arrive after a newer one was already applied
+		if (nonAckedMoves.empty() || ack.moveID < nonAckedMoves.front().moveID)
 		{
-			uint32 ackedID = 0;
-			while (ack.moveID != ackedID)
-			{
-				ackedID = nonAckedMoves.front().moveID;
-				nonAckedMoves.pop();
-			}
+			return;
+		}
 
-			[[maybe_unused]] auto testPlayerRotationPre = GetActorRotation().Yaw;
-			[[maybe_unused]] auto testLookAtRotationPre = PlayerCamera->GetComponentRotation().Pitch;
-			SetActorLocation(ack.playerLocation);
-			SetActorRotation(FRotator{ 0.f, ack.playerRotation, 0.f });
-			PlayerCamera->SetRelativeRotation(FRotator{ ack.lookAtRotation, 0.f, 0.f });
-			[[maybe_unused]] auto testPlayerRotationPost = GetActorRotation().Yaw;
-			[[maybe_unused]] auto testLookAtRotationPost = PlayerCamera->GetComponentRotation().Pitch;
+		double ackedMoveTimestamp = 0.0;
+		while (!nonAckedMoves.empty() && nonAckedMoves.front().moveID <= ack.moveID)
+		{
+			ackedMoveTimestamp = nonAckedMoves.front().timestamp;
+			nonAckedMoves.pop_front();
+		}
+		RecordTelemetry(ETelemetrySeries::Rtt, registry->GetServerWorldTimeSeconds() - ackedMoveTimestamp);
+		RecordTelemetry(ETelemetrySeries::UnackedDepth, nonAckedMoves.size());
 
-			std::queue<FPlayerMove> tempQueue {nonAckedMoves};
-			while (!tempQueue.empty())
-			{
-				ApplyMovement(tempQueue.front());
-				tempQueue.pop();
-			}
+		FVector predictedLocation = GetActorLocation();
 
-			UpdateWidget_ServerInfo(ack.playerLocation);
-			UpdateWidget_AckedMoves(ack.moveID);
+		[[maybe_unused]] auto testPlayerRotationPre = GetActorRotation().Yaw;
+		[[maybe_unused]] auto testLookAtRotationPre = PlayerCamera->GetComponentRotation().Pitch;
+		SetActorLocation(ack.playerLocation);
+		SetActorRotation(FRotator{ 0.f, ack.playerRotation, 0.f });
+		PlayerCamera->SetRelativeRotation(FRotator{ ack.lookAtRotation, 0.f, 0.f });
+		[[maybe_unused]] auto testPlayerRotationPost = GetActorRotation().Yaw;
+		[[maybe_unused]] auto testLookAtRotationPost = PlayerCamera->GetComponentRotation().Pitch;
+
+		for (const FPlayerMove& move : nonAckedMoves)
+		{
+			ApplyMovement(move);
 		}
-	}
-	else if (role == ROLE_SimulatedProxy)
-	{
-		serverPositionsToSimulate.push(ack.playerLocation);
-		if (!startSimulateMovement && serverPositionsToSimulate.size() > 2)
+
+		float mispredictionError = FVector::Dist(predictedLocation, GetActorLocation());
+		RecordTelemetry(ETelemetrySeries::CorrectionMagnitude, mispredictionError);
+		clientNetStats.acksReceived++;
+		if (mispredictionError > CorrectionTolerance)
 		{
-			oldestServerPosition = serverPositionsToSimulate.front();
-			serverPositionsToSimulate.pop();
-			startSimulateMovement = true;
+			clientNetStats.corrections++;
+			clientNetStats.mispredictionErrorSum += mispredictionError;
+			clientNetStats.mispredictionErrorMax = FMath::Max(clientNetStats.mispredictionErrorMax, mispredictionError);
 		}
+
+		UpdateWidget_ServerInfo(ack.playerLocation);
+		UpdateWidget_AckedMoves(ack.moveID);
+		if (latencyTracer)
+		{
+			latencyTracer->MarkReconciled(ack.traceID);
+		}
+	}
+}
+
+void APlayerCharacter::ReceiveProxySnapshot(const FProxySnapshot& snapshot)
+{
+	if (GetLocalRole() != ROLE_SimulatedProxy)
+	{
+		return;
 	}
 
+	FServerMoveAck state{};
+	state.timestamp = snapshot.timestamp;
+	state.playerLocation = snapshot.location;
+	state.playerRotation = snapshot.yaw;
+	state.lookAtRotation = snapshot.pitch;
+	serverPositionsToSimulate.push(state);
+	if (!startSimulateMovement && serverPositionsToSimulate.size() > 2)
+	{
+		oldestServerState = serverPositionsToSimulate.front();
+		serverPositionsToSimulate.pop();
+		startSimulateMovement = true;
+	}
+}
+
+void APlayerCharacter::PossessedBy(AController* NewController)
+{
+	Super::PossessedBy(NewController);
+
+	if (ANetworkedPlayerController* controller = Cast<ANetworkedPlayerController>(NewController))
+	{
+		controller->ApplyMatchTo(this);
+	}
 }
 
 void APlayerCharacter::SetPlayerColor(const FLinearColor& newColor)
@@ -525,3 +997,22 @@ void APlayerCharacter::SetPlayerColor(const FLinearColor& newColor)
 	PlayerColor = newColor;
 }
 
+void APlayerCharacter::SetMatchId(int32 newMatchId)
+{
+	matchId = newMatchId;
+	if (registry)
+	{
+		registry->SetPlayerMatch(registrySlot, matchId);
+	}
+}
+
+bool APlayerCharacter::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	const APlayerCharacter* viewerPlayer = Cast<APlayerCharacter>(ViewTarget);
+	if (viewerPlayer && viewerPlayer->GetMatchId() != matchId)
+	{
+		return false;
+	}
+	return Super::IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation);
+}
+
@@ -0,0 +1,111 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PlayerRegistrySubsystem.h"
+#include "PlayerCharacter.h"
+#include "GameFramework/GameStateBase.h"
+
+void UPlayerRegistrySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	UWorld* world = GetWorld();
+	gameState = world->GetGameState();
+	gameStateSetHandle = world->GameStateSetEvent.AddUObject(this, &UPlayerRegistrySubsystem::OnGameStateSet);
+}
+
+void UPlayerRegistrySubsystem::Deinitialize()
+{
+	GetWorld()->GameStateSetEvent.Remove(gameStateSetHandle);
+	players.Reset();
+	denseToSlot.Reset();
+	slotToDense.Reset();
+	freeSlots.Reset();
+	slotToMatch.Reset();
+	matchPlayers.Reset();
+	gameState = nullptr;
+	Super::Deinitialize();
+}
+
+int32 UPlayerRegistrySubsystem::Register(APlayerCharacter* player)
+{
+	int32 slot = freeSlots.Num() > 0 ? freeSlots.Pop(false) : slotToDense.AddUninitialized();
+	slotToDense[slot] = players.Add(player);
+	denseToSlot.Add(slot);
+
+	slotToMatch.SetNum(slotToDense.Num());
+	slotToMatch[slot] = 0;
+	matchPlayers.FindOrAdd(0).players.Add(player);
+	return slot;
+}
+
+void UPlayerRegistrySubsystem::Unregister(int32 slot)
+{
+	if (!slotToDense.IsValidIndex(slot) || slotToDense[slot] == INDEX_NONE)
+	{
+		return;
+	}
+
+	RemoveFromMatch(slot, players[slotToDense[slot]]);
+
+	// Move the last player into the freed dense index so iteration stays contiguous
+	int32 denseIndex = slotToDense[slot];
+	int32 lastIndex = players.Num() - 1;
+	if (denseIndex != lastIndex)
+	{
+		players[denseIndex] = players[lastIndex];
+		denseToSlot[denseIndex] = denseToSlot[lastIndex];
+		slotToDense[denseToSlot[denseIndex]] = denseIndex;
+	}
+	players.Pop(false);
+	denseToSlot.Pop(false);
+
+	slotToDense[slot] = INDEX_NONE;
+	freeSlots.Add(slot);
+}
+
+const TArray<APlayerCharacter*>& UPlayerRegistrySubsystem::GetMatchPlayers(int32 matchId) const
+{
+	static const TArray<APlayerCharacter*> noPlayers;
+	const FMatchPlayers* found = matchPlayers.Find(matchId);
+	return found ? ToRawPtrTArrayUnsafe(found->players) : noPlayers;
+}
+
+void UPlayerRegistrySubsystem::SetPlayerMatch(int32 slot, int32 matchId)
+{
+	APlayerCharacter* player = GetPlayerInSlot(slot);
+	if (!player || slotToMatch[slot] == matchId)
+	{
+		return;
+	}
+
+	RemoveFromMatch(slot, player);
+
+	slotToMatch[slot] = matchId;
+	matchPlayers.FindOrAdd(matchId).players.Add(player);
+}
+
+void UPlayerRegistrySubsystem::RemoveFromMatch(int32 slot, APlayerCharacter* player)
+{
+	TArray<TObjectPtr<APlayerCharacter>>& match = matchPlayers.FindChecked(slotToMatch[slot]).players;
+	match.RemoveSingleSwap(player, false);
+	if (match.Num() == 0)
+	{
+		matchPlayers.Remove(slotToMatch[slot]);
+	}
+}
+
+APlayerCharacter* UPlayerRegistrySubsystem::GetPlayerInSlot(int32 slot) const
+{
+	return slotToDense.IsValidIndex(slot) && slotToDense[slot] != INDEX_NONE ? players[slotToDense[slot]] : nullptr;
+}
+
+double UPlayerRegistrySubsystem::GetServerWorldTimeSeconds() const
+{
+	return gameState ? gameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+}
+
+void UPlayerRegistrySubsystem::OnGameStateSet(AGameStateBase* newGameState)
+{
+	gameState = newGameState;
+}
@@ -0,0 +1,133 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RollbackHistory.h"
+#include "Algo/BinarySearch.h"
+
+void FRollbackHistory::Append(double timestamp, const FVector& location, float yaw, float pitch)
+{
+	if (blocks.Num() > 0 && TryAppendDelta(blocks.Last(), timestamp, location, yaw, pitch))
+	{
+		return;
+	}
+
+	FHistoryBlock& block = blocks.AddZeroed_GetRef();
+	block.keyTimestamp = timestamp;
+	block.keyX = location.X;
+	block.keyY = location.Y;
+	block.keyZ = location.Z;
+	block.keyYaw = FRotator::CompressAxisToShort(yaw);
+	block.keyPitch = FRotator::CompressAxisToShort(pitch);
+}
+
+bool FRollbackHistory::TryAppendDelta(FHistoryBlock& block, double timestamp, const FVector& location, float yaw, float pitch)
+{
+	if (block.numDeltas == DeltasPerBlock)
+	{
+		return false;
+	}
+
+	double time = FMath::RoundToDouble((timestamp - block.keyTimestamp) / TimeStep);
+	double x = FMath::RoundToDouble((location.X - block.keyX) / PositionStep);
+	double y = FMath::RoundToDouble((location.Y - block.keyY) / PositionStep);
+	double z = FMath::RoundToDouble((location.Z - block.keyZ) / PositionStep);
+	if (time < 0.0 || time > MAX_uint16
+		|| FMath::Abs(x) > MAX_int16 || FMath::Abs(y) > MAX_int16 || FMath::Abs(z) > MAX_int16)
+	{
+		return false;
+	}
+
+	FHistoryDelta& delta = block.deltas[block.numDeltas++];
+	delta.time = uint16(time);
+	delta.x = int16(x);
+	delta.y = int16(y);
+	delta.z = int16(z);
+	delta.yaw = FRotator::CompressAxisToShort(yaw);
+	delta.pitch = FRotator::CompressAxisToShort(pitch);
+	return true;
+}
+
+void FRollbackHistory::Trim(double oldestTimestamp)
+{
+	int32 removeCount = 0;
+	while (removeCount + 1 < blocks.Num() && blocks[removeCount + 1].keyTimestamp <= oldestTimestamp)
+	{
+		removeCount++;
+	}
+
+	if (removeCount > 0)
+	{
+		blocks.RemoveAt(0, removeCount, false);
+	}
+}
+
+double FRollbackHistory::GetNewestTimestamp() const
+{
+	return blocks.Num() > 0 ? DecodeTimestamp(blocks.Num() - 1, NumSamples(blocks.Num() - 1) - 1) : 0.0;
+}
+
+double FRollbackHistory::DecodeTimestamp(int32 blockIndex, int32 sampleIndex) const
+{
+	const FHistoryBlock& block = blocks[blockIndex];
+	return sampleIndex == 0 ? block.keyTimestamp : block.keyTimestamp + block.deltas[sampleIndex - 1].time * TimeStep;
+}
+
+FRollbackSample FRollbackHistory::Decode(int32 blockIndex, int32 sampleIndex) const
+{
+	const FHistoryBlock& block = blocks[blockIndex];
+	FRollbackSample sample{};
+	sample.timestamp = block.keyTimestamp;
+	sample.location = FVector{ block.keyX, block.keyY, block.keyZ };
+	sample.yaw = FRotator::DecompressAxisFromShort(block.keyYaw);
+	sample.pitch = FRotator::DecompressAxisFromShort(block.keyPitch);
+
+	if (sampleIndex > 0)
+	{
+		const FHistoryDelta& delta = block.deltas[sampleIndex - 1];
+		sample.timestamp += delta.time * TimeStep;
+		sample.location += FVector{ double(delta.x), double(delta.y), double(delta.z) } * PositionStep;
+		sample.yaw = FRotator::DecompressAxisFromShort(delta.yaw);
+		sample.pitch = FRotator::DecompressAxisFromShort(delta.pitch);
+	}
+	return sample;
+}
+
+bool FRollbackHistory::Sample(double timestamp, FRollbackSample& outSample) const
+{
+	if (blocks.Num() == 0)
+	{
+		return false;
+	}
+
+	// Last block whose keyframe is not newer than the timestamp
+	int32 blockIndex = Algo::UpperBoundBy(blocks, timestamp, [](const FHistoryBlock& block) { return block.keyTimestamp; }) - 1;
+	if (blockIndex < 0)
+	{
+		outSample = Decode(0, 0);
+		return true;
+	}
+
+	int32 sampleIndex = 0;
+	while (sampleIndex + 1 < NumSamples(blockIndex) && DecodeTimestamp(blockIndex, sampleIndex + 1) <= timestamp)
+	{
+		sampleIndex++;
+	}
+
+	FRollbackSample older = Decode(blockIndex, sampleIndex);
+	int32 newerBlock = sampleIndex + 1 < NumSamples(blockIndex) ? blockIndex : blockIndex + 1;
+	int32 newerSample = newerBlock == blockIndex ? sampleIndex + 1 : 0;
+	if (newerBlock >= blocks.Num())
+	{
+		outSample = older;
+		return true;
+	}
+
+	FRollbackSample newer = Decode(newerBlock, newerSample);
+	double alpha = newer.timestamp > older.timestamp ? (timestamp - older.timestamp) / (newer.timestamp - older.timestamp) : 1.0;
+
+	outSample.timestamp = timestamp;
+	outSample.location = FMath::Lerp(older.location, newer.location, alpha);
+	outSample.yaw = older.yaw + FRotator::NormalizeAxis(newer.yaw - older.yaw) * float(alpha);
+	outSample.pitch = older.pitch + FRotator::NormalizeAxis(newer.pitch - older.pitch) * float(alpha);
+	return true;
+}
@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ServerFrameTimer.h"
+#include "Misc/CoreDelegates.h"
+
+void FServerFrameTimer::Start(UWorld* inWorld)
+{
+	Stop();
+	world = inWorld;
+	tickStartHandle = FWorldDelegates::OnWorldTickStart.AddRaw(this, &FServerFrameTimer::OnWorldTickStart);
+	endFrameHandle = FCoreDelegates::OnEndFrame.AddRaw(this, &FServerFrameTimer::OnEndFrame);
+}
+
+void FServerFrameTimer::Stop()
+{
+	FWorldDelegates::OnWorldTickStart.Remove(tickStartHandle);
+	FCoreDelegates::OnEndFrame.Remove(endFrameHandle);
+	tickStartHandle.Reset();
+	endFrameHandle.Reset();
+	frameStartCycles = 0;
+}
+
+void FServerFrameTimer::OnWorldTickStart(UWorld* tickedWorld, ELevelTick tickType, float deltaSeconds)
+{
+	if (tickedWorld == world.Get())
+	{
+		frameStartCycles = FPlatformTime::Cycles64();
+	}
+}
+
+void FServerFrameTimer::OnEndFrame()
+{
+	if (frameStartCycles != 0)
+	{
+		lastFrameMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - frameStartCycles);
+		frameStartCycles = 0;
+	}
+}
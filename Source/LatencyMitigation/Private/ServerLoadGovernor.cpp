@@ -0,0 +1,245 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ServerLoadGovernor.h"
+#include "PlayerRegistrySubsystem.h"
+
+static TAutoConsoleVariable<bool> CVarGovernorEnabled(
+	TEXT("lm.Governor.Enabled"),
+	true,
+	TEXT("Shed server work when frame time goes over lm.Governor.FrameBudgetMs"));
+
+static TAutoConsoleVariable<float> CVarGovernorFrameBudgetMs(
+	TEXT("lm.Governor.FrameBudgetMs"),
+	16.0f,
+	TEXT("Server game thread time per frame the load governor tries to stay under"));
+
+static TAutoConsoleVariable<float> CVarGovernorEscalateDelay(
+	TEXT("lm.Governor.EscalateDelay"),
+	0.5f,
+	TEXT("Seconds over budget before the load level goes up by one"));
+
+static TAutoConsoleVariable<float> CVarGovernorRecoverDelay(
+	TEXT("lm.Governor.RecoverDelay"),
+	2.0f,
+	TEXT("Seconds under lm.Governor.RecoverFraction of the budget before the load level goes down by one"));
+
+static TAutoConsoleVariable<float> CVarGovernorRecoverFraction(
+	TEXT("lm.Governor.RecoverFraction"),
+	0.8f,
+	TEXT("Fraction of the frame budget the server has to stay under to recover"));
+
+static TAutoConsoleVariable<float> CVarGovernorCombatPriorityWindow(
+	TEXT("lm.Governor.CombatPriorityWindow"),
+	2.0f,
+	TEXT("Viewers that fired or were hit within this many seconds keep their full snapshot rate"));
+
+static TAutoConsoleVariable<float> CVarGovernorLowPriorityScalePerLevel(
+	TEXT("lm.Governor.LowPriorityScalePerLevel"),
+	0.5f,
+	TEXT("Snapshot interval multiplier added per load level for low priority viewers"));
+
+static TAutoConsoleVariable<float> CVarGovernorScaleSlewRate(
+	TEXT("lm.Governor.ScaleSlewRate"),
+	1.0f,
+	TEXT("How fast per second a low priority viewer's snapshot interval multiplier moves to its target"));
+
+static TAutoConsoleVariable<int32> CVarGovernorShotCapLevel(
+	TEXT("lm.Governor.ShotCapLevel"),
+	2,
+	TEXT("Load level from which shots resolved per frame are capped"));
+
+static TAutoConsoleVariable<int32> CVarGovernorMaxShotsPerFrame(
+	TEXT("lm.Governor.MaxShotsPerFrame"),
+	8,
+	TEXT("Shots resolved per frame at lm.Governor.ShotCapLevel, halved for every level above"));
+
+static TAutoConsoleVariable<int32> CVarGovernorMaxDeferredShots(
+	TEXT("lm.Governor.MaxDeferredShots"),
+	64,
+	TEXT("Shots that may wait for a later frame, newer ones beyond this are rejected"));
+
+static TAutoConsoleVariable<float> CVarGovernorMaxShotDeferral(
+	TEXT("lm.Governor.MaxShotDeferral"),
+	0.25f,
+	TEXT("Seconds a deferred shot may wait before it is rejected"));
+
+static TAutoConsoleVariable<int32> CVarGovernorHistoryShrinkLevel(
+	TEXT("lm.Governor.HistoryShrinkLevel"),
+	3,
+	TEXT("Load level from which rollback history is shrunk"));
+
+static TAutoConsoleVariable<float> CVarGovernorMinRollbackWindowScale(
+	TEXT("lm.Governor.MinRollbackWindowScale"),
+	0.5f,
+	TEXT("Fraction of the rollback window kept once history is shrunk"));
+
+bool UServerLoadGovernor::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* world = Cast<UWorld>(Outer);
+	return world && world->IsGameWorld() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UServerLoadGovernor::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	Collection.InitializeDependency<UPlayerRegistrySubsystem>();
+	tickStartHandle = FWorldDelegates::OnWorldTickStart.AddUObject(this, &UServerLoadGovernor::OnWorldTickStart);
+	frameTimer.Start(GetWorld());
+}
+
+void UServerLoadGovernor::Deinitialize()
+{
+	FWorldDelegates::OnWorldTickStart.Remove(tickStartHandle);
+	frameTimer.Stop();
+	Super::Deinitialize();
+}
+
+void UServerLoadGovernor::NoteDeferredShots(int32 numDeferred, int32 numWaiting)
+{
+	shotsDeferredSinceReport += numDeferred;
+	shotsWaiting = numWaiting;
+}
+
+void UServerLoadGovernor::NoteRejectedShots(int32 numRejected)
+{
+	shotsRejectedSinceReport += numRejected;
+}
+
+void UServerLoadGovernor::OnWorldTickStart(UWorld* world, ELevelTick tickType, float deltaSeconds)
+{
+	if (world != GetWorld() || world->GetNetMode() == NM_Client)
+	{
+		return;
+	}
+
+	// Game thread time of the previous frame, without the time spent waiting for the next tick
+	float frameMs = frameTimer.GetLastFrameMs();
+	smoothedFrameMs = smoothedFrameMs > 0.f ? FMath::Lerp(smoothedFrameMs, frameMs, 0.1f) : frameMs;
+
+	if (CVarGovernorEnabled.GetValueOnGameThread())
+	{
+		UpdateLoadLevel(deltaSeconds);
+	}
+	else if (loadLevel > 0)
+	{
+		SetLoadLevel(0);
+	}
+
+	UpdateSnapshotScales(deltaSeconds);
+
+	reportCounter += deltaSeconds;
+	if (reportCounter >= 1.f)
+	{
+		reportCounter = 0.f;
+		if (shotsDeferredSinceReport > 0 || shotsRejectedSinceReport > 0)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Server load governor: deferred %d shots to later frames, rejected %d stale or overflowing shots, %d still waiting"),
+				shotsDeferredSinceReport, shotsRejectedSinceReport, shotsWaiting);
+			shotsDeferredSinceReport = 0;
+			shotsRejectedSinceReport = 0;
+		}
+	}
+}
+
+void UServerLoadGovernor::UpdateLoadLevel(float deltaSeconds)
+{
+	float budgetMs = CVarGovernorFrameBudgetMs.GetValueOnGameThread();
+	if (smoothedFrameMs > budgetMs)
+	{
+		underBudgetTime = 0.f;
+		overBudgetTime += deltaSeconds;
+		if (overBudgetTime >= CVarGovernorEscalateDelay.GetValueOnGameThread() && loadLevel < MaxLoadLevel)
+		{
+			overBudgetTime = 0.f;
+			SetLoadLevel(loadLevel + 1);
+		}
+	}
+	else if (smoothedFrameMs < budgetMs * CVarGovernorRecoverFraction.GetValueOnGameThread())
+	{
+		overBudgetTime = 0.f;
+		underBudgetTime += deltaSeconds;
+		if (underBudgetTime >= CVarGovernorRecoverDelay.GetValueOnGameThread() && loadLevel > 0)
+		{
+			underBudgetTime = 0.f;
+			SetLoadLevel(loadLevel - 1);
+		}
+	}
+	else
+	{
+		overBudgetTime = 0.f;
+		underBudgetTime = 0.f;
+	}
+}
+
+void UServerLoadGovernor::SetLoadLevel(int32 newLevel)
+{
+	int32 oldLevel = loadLevel;
+	loadLevel = newLevel;
+
+	int32 shotCap = GetShotCap();
+	FString shotCapText = shotCap == MAX_int32 ? TEXT("uncapped") : FString::Printf(TEXT("%d per frame"), shotCap);
+	UE_LOG(LogTemp, Warning, TEXT("Server load governor: level %d -> %d at %.2f ms (budget %.2f ms). Low priority snapshot interval x%.1f, shot resolution %s, rollback window %.0f%%"),
+		oldLevel, newLevel, smoothedFrameMs, CVarGovernorFrameBudgetMs.GetValueOnGameThread(), GetLowPriorityScale(), *shotCapText, GetRollbackWindowScale() * 100.f);
+}
+
+void UServerLoadGovernor::UpdateSnapshotScales(float deltaSeconds)
+{
+	UPlayerRegistrySubsystem* registry = GetWorld()->GetSubsystem<UPlayerRegistrySubsystem>();
+	double now = registry->GetServerWorldTimeSeconds();
+	float combatWindow = CVarGovernorCombatPriorityWindow.GetValueOnGameThread();
+	float slewRate = CVarGovernorScaleSlewRate.GetValueOnGameThread();
+	float lowPriorityScale = GetLowPriorityScale();
+	float rollbackWindowScale = GetRollbackWindowScale();
+
+	for (APlayerCharacter* player : registry->GetPlayers())
+	{
+		player->SetRollbackWindowScale(rollbackWindowScale);
+	}
+
+	// Snapshots are scheduled per receiving connection, slow down what low priority viewers receive
+	for (FConstPlayerControllerIterator it = GetWorld()->GetPlayerControllerIterator(); it; ++it)
+	{
+		ANetworkedPlayerController* viewer = Cast<ANetworkedPlayerController>(it->Get());
+		if (!viewer)
+		{
+			continue;
+		}
+
+		APlayerCharacter* viewerPawn = Cast<APlayerCharacter>(viewer->GetPawn());
+		// Viewers in a fight, shooting or being shot at, keep seeing the others at full rate
+		bool highPriority = viewerPawn && (now - viewerPawn->GetLastFireTime() < combatWindow || now - viewerPawn->GetLastHitTime() < combatWindow);
+		float scale = highPriority ? 1.f : FMath::FInterpConstantTo(viewer->GetSnapshotIntervalScale(), lowPriorityScale, deltaSeconds, slewRate);
+		viewer->SetSnapshotIntervalScale(scale);
+	}
+}
+
+int32 UServerLoadGovernor::GetShotCap() const
+{
+	int32 shotCapLevel = CVarGovernorShotCapLevel.GetValueOnGameThread();
+	if (loadLevel < shotCapLevel)
+	{
+		return MAX_int32;
+	}
+	return FMath::Max(CVarGovernorMaxShotsPerFrame.GetValueOnGameThread() >> (loadLevel - shotCapLevel), 1);
+}
+
+int32 UServerLoadGovernor::GetMaxDeferredShots() const
+{
+	return FMath::Max(CVarGovernorMaxDeferredShots.GetValueOnGameThread(), 0);
+}
+
+float UServerLoadGovernor::GetMaxShotDeferral() const
+{
+	return CVarGovernorMaxShotDeferral.GetValueOnGameThread();
+}
+
+float UServerLoadGovernor::GetLowPriorityScale() const
+{
+	return 1.f + loadLevel * CVarGovernorLowPriorityScalePerLevel.GetValueOnGameThread();
+}
+
+float UServerLoadGovernor::GetRollbackWindowScale() const
+{
+	return loadLevel >= CVarGovernorHistoryShrinkLevel.GetValueOnGameThread() ? CVarGovernorMinRollbackWindowScale.GetValueOnGameThread() : 1.f;
+}
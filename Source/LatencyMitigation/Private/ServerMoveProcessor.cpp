@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ServerMoveProcessor.h"
+#include "PlayerRegistrySubsystem.h"
+#include "Async/ParallelFor.h"
+
+bool UServerMoveProcessor::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* world = Cast<UWorld>(Outer);
+	return world && world->IsGameWorld() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UServerMoveProcessor::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	Collection.InitializeDependency<UPlayerRegistrySubsystem>();
+	preActorTickHandle = FWorldDelegates::OnWorldPreActorTick.AddUObject(this, &UServerMoveProcessor::OnWorldPreActorTick);
+}
+
+void UServerMoveProcessor::Deinitialize()
+{
+	FWorldDelegates::OnWorldPreActorTick.Remove(preActorTickHandle);
+	jobs.Reset();
+	Super::Deinitialize();
+}
+
+void UServerMoveProcessor::OnWorldPreActorTick(UWorld* world, ELevelTick tickType, float deltaSeconds)
+{
+	if (world != GetWorld() || world->GetNetMode() == NM_Client)
+	{
+		return;
+	}
+
+	// Gather on the game thread, worker threads only see plain copies
+	jobs.Reset();
+	for (APlayerCharacter* player : world->GetSubsystem<UPlayerRegistrySubsystem>()->GetPlayers())
+	{
+		if (player->HasPendingServerMoves())
+		{
+			FMoveJob& job = jobs.AddDefaulted_GetRef();
+			job.player = player;
+			job.state = player->GetMovementState();
+			job.moves = player->TakePendingServerMoves();
+			job.movementSpeed = player->MovementSpeed;
+			job.turnSpeed = player->TurnSpeed;
+		}
+	}
+
+	if (jobs.Num() == 0)
+	{
+		return;
+	}
+
+	ParallelFor(jobs.Num(), [this](int32 index)
+		{
+			FMoveJob& job = jobs[index];
+			for (const FPlayerMove& move : job.moves)
+			{
+				job.state = APlayerCharacter::SimulateMove(job.state, move, job.movementSpeed, job.turnSpeed);
+			}
+		}, jobs.Num() < MinParallelPlayers);
+
+	for (const FMoveJob& job : jobs)
+	{
+		job.player->CommitServerMoves(job.state, job.moves.Last().moveID, job.moves.Num());
+	}
+}
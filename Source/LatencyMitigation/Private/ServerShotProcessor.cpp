@@ -0,0 +1,152 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ServerShotProcessor.h"
+#include "PlayerRegistrySubsystem.h"
+#include "ServerLoadGovernor.h"
+#include "Async/ParallelFor.h"
+
+bool UServerShotProcessor::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* world = Cast<UWorld>(Outer);
+	return world && world->IsGameWorld() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UServerShotProcessor::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	Collection.InitializeDependency<UPlayerRegistrySubsystem>();
+	Collection.InitializeDependency<UServerLoadGovernor>();
+	postActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UServerShotProcessor::OnWorldPostActorTick);
+}
+
+void UServerShotProcessor::Deinitialize()
+{
+	FWorldDelegates::OnWorldPostActorTick.Remove(postActorTickHandle);
+	queuedShots.Reset();
+	jobs.Reset();
+	Super::Deinitialize();
+}
+
+void UServerShotProcessor::QueueShot(APlayerCharacter* shooter, const FPendingShot& shot)
+{
+	queuedShots.Add(FQueuedShot{ shooter, shot });
+}
+
+int32 UServerShotProcessor::RejectStaleShots(const UServerLoadGovernor* governor)
+{
+	double now = FPlatformTime::Seconds();
+	float maxDeferral = governor ? governor->GetMaxShotDeferral() : MAX_flt;
+	int32 numRejected = 0;
+	queuedShots.RemoveAll([now, maxDeferral, &numRejected](const FQueuedShot& queued)
+		{
+			APlayerCharacter* shooter = queued.shooter.Get();
+			if (!shooter)
+			{
+				return true;
+			}
+
+			// Too long in the queue, or older than the shooter's rollback history once the governor shrank it
+			if ((queued.deferredSince > 0.0 && now - queued.deferredSince > maxDeferral) || !shooter->CanRewindTo(queued.shot.timestamp))
+			{
+				shooter->RejectShot(queued.shot);
+				numRejected++;
+				return true;
+			}
+			return false;
+		});
+	return numRejected;
+}
+
+void UServerShotProcessor::OnWorldPostActorTick(UWorld* world, ELevelTick tickType, float deltaSeconds)
+{
+	if (world != GetWorld() || world->GetNetMode() == NM_Client || queuedShots.Num() == 0)
+	{
+		return;
+	}
+
+	UServerLoadGovernor* governor = world->GetSubsystem<UServerLoadGovernor>();
+	int32 numRejected = RejectStaleShots(governor);
+	int32 shotCap = governor ? governor->GetShotCap() : MAX_int32;
+	double now = FPlatformTime::Seconds();
+
+	// Gather on the game thread, the level trace stays here and workers only read pose history and hitboxes
+	UPlayerRegistrySubsystem* registry = world->GetSubsystem<UPlayerRegistrySubsystem>();
+	jobs.Reset();
+	int32 numKept = 0;
+	int32 newlyDeferred = 0;
+	for (int32 i = 0; i < queuedShots.Num(); ++i)
+	{
+		FQueuedShot& queued = queuedShots[i];
+		APlayerCharacter* shooter = queued.shooter.Get();
+		if (!shooter)
+		{
+			continue;
+		}
+
+		// The move carrying the aim the shot was fired with may still be on its way or held for a gap
+		bool moveApplied = shooter->HasAppliedMove(queued.shot.moveID) || now - queued.shot.receiveTime > MaxMoveWait;
+		if (!moveApplied || jobs.Num() >= shotCap)
+		{
+			if (moveApplied && queued.deferredSince == 0.0)
+			{
+				queued.deferredSince = now;
+				newlyDeferred++;
+			}
+			queuedShots[numKept++] = queued;
+			continue;
+		}
+
+		FShotJob& job = jobs.AddDefaulted_GetRef();
+		job.shooter = shooter;
+		job.shot = queued.shot;
+		shooter->GetShotRay(job.shot.start, job.shot.end);
+		job.clippedEnd = shooter->TraceLevel(job.shot.start, job.shot.end);
+		for (APlayerCharacter* target : registry->GetMatchPlayers(shooter->GetMatchId()))
+		{
+			if (target != shooter)
+			{
+				job.targets.Add(target);
+				job.poses.Add(target->GetCurrentPose());
+			}
+		}
+	}
+	queuedShots.SetNum(numKept, false);
+
+	// The backlog is bounded, the newest shots beyond it are rejected so the ones already waiting keep their order
+	int32 maxDeferred = governor ? governor->GetMaxDeferredShots() : MAX_int32;
+	for (int32 i = queuedShots.Num() - 1; i >= maxDeferred; --i)
+	{
+		if (APlayerCharacter* shooter = queuedShots[i].shooter.Get())
+		{
+			shooter->RejectShot(queuedShots[i].shot);
+		}
+		numRejected++;
+	}
+	queuedShots.SetNum(FMath::Min(queuedShots.Num(), maxDeferred), false);
+	if (governor)
+	{
+		governor->NoteDeferredShots(newlyDeferred, queuedShots.Num());
+		governor->NoteRejectedShots(numRejected);
+	}
+
+	ParallelFor(jobs.Num(), [this](int32 index)
+		{
+			FShotJob& job = jobs[index];
+			FHitboxQuery query{ job.shot.start, job.clippedEnd };
+			for (int32 i = 0; i < job.targets.Num(); ++i)
+			{
+				// Falls back to the current pose gathered above when there is no history for the timestamp
+				job.targets[i]->SampleHistoricalPose(job.shot.timestamp, job.poses[i]);
+				query.AddShapes(job.targets[i]->Hitboxes, job.poses[i], i);
+			}
+
+			FHitboxHit hit;
+			job.hitIndex = query.Raycast(hit) ? hit.owner : INDEX_NONE;
+		}, jobs.Num() < MinParallelShots);
+
+	for (const FShotJob& job : jobs)
+	{
+		job.shooter->CommitShot(job.shot, job.hitIndex != INDEX_NONE ? job.targets[job.hitIndex] : nullptr, job.targets, job.poses);
+	}
+}
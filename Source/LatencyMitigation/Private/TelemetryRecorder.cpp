@@ -0,0 +1,106 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TelemetryRecorder.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Paths.h"
+
+FTelemetryRecorder::FTelemetryRecorder(const FString& inFilePath, uint32 queueCapacity) :
+	filePath{ inFilePath },
+	queue{ queueCapacity }
+{
+}
+
+FTelemetryRecorder::~FTelemetryRecorder()
+{
+	Shutdown();
+}
+
+bool FTelemetryRecorder::Start()
+{
+	IPlatformFile& platformFile = FPlatformFileManager::Get().GetPlatformFile();
+	platformFile.CreateDirectoryTree(*FPaths::GetPath(filePath));
+	fileHandle.Reset(platformFile.OpenWrite(*filePath, true));
+	if (!fileHandle)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Telemetry: failed to open %s"), *filePath);
+		return false;
+	}
+
+	if (fileHandle->Size() == 0)
+	{
+		FTelemetryFileHeader fileHeader{};
+		fileHeader.blockRows = BlockRows;
+		fileHeader.startTicks = FDateTime::UtcNow().GetTicks();
+		fileHeader.blockBytes = sizeof(FColumnBlock);
+		fileHandle->Write(reinterpret_cast<const uint8*>(&fileHeader), sizeof(fileHeader));
+	}
+
+	blocks.SetNumZeroed(int32(ETelemetrySeries::Count));
+	for (int32 series = 0; series < blocks.Num(); ++series)
+	{
+		blocks[series].header = FTelemetryBlockHeader{};
+		blocks[series].header.series = series;
+	}
+
+	thread = FRunnableThread::Create(this, TEXT("TelemetryRecorder"), 0, TPri_BelowNormal);
+	return thread != nullptr;
+}
+
+void FTelemetryRecorder::Shutdown()
+{
+	if (thread)
+	{
+		Stop();
+		thread->WaitForCompletion();
+		delete thread;
+		thread = nullptr;
+	}
+	fileHandle.Reset();
+}
+
+uint32 FTelemetryRecorder::Run()
+{
+	while (!stopRequested)
+	{
+		Drain();
+		FPlatformProcess::Sleep(0.01f);
+	}
+
+	// Flush whatever the game thread produced before shutdown, including partial blocks
+	Drain();
+	for (FColumnBlock& block : blocks)
+	{
+		if (block.header.rowCount > 0)
+		{
+			WriteBlock(block);
+		}
+	}
+	fileHandle->Flush();
+	return 0;
+}
+
+void FTelemetryRecorder::Drain()
+{
+	FTelemetrySample sample;
+	while (queue.Dequeue(sample))
+	{
+		FColumnBlock& block = blocks[int32(sample.series)];
+		uint32 row = block.header.rowCount++;
+		block.time[row] = sample.time;
+		block.connectionId[row] = sample.connectionId;
+		block.value[row] = sample.value;
+
+		if (block.header.rowCount == BlockRows)
+		{
+			WriteBlock(block);
+		}
+	}
+}
+
+void FTelemetryRecorder::WriteBlock(FColumnBlock& block)
+{
+	fileHandle->Write(reinterpret_cast<const uint8*>(&block), sizeof(FColumnBlock));
+	block.header.rowCount = 0;
+}
@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TelemetrySubsystem.h"
+#include "Misc/Paths.h"
+
+static TAutoConsoleVariable<bool> CVarTelemetryEnabled(
+	TEXT("lm.Telemetry.Enabled"),
+	true,
+	TEXT("Record per connection latency telemetry to Saved/Telemetry"));
+
+bool UTelemetrySubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* world = Cast<UWorld>(Outer);
+	return world && world->IsGameWorld() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UTelemetrySubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	if (!CVarTelemetryEnabled.GetValueOnGameThread())
+	{
+		return;
+	}
+
+	const TCHAR* netMode = InWorld.GetNetMode() == NM_Client ? TEXT("Client") : TEXT("Server");
+	FString fileName = FString::Printf(TEXT("%s_%s_%s_%u.lmtl"), *InWorld.GetMapName(), netMode, *FDateTime::Now().ToString(), FPlatformProcess::GetCurrentProcessId());
+	recorder = MakeUnique<FTelemetryRecorder>(FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Telemetry"), fileName));
+	if (!recorder->Start())
+	{
+		recorder.Reset();
+	}
+}
+
+void UTelemetrySubsystem::Deinitialize()
+{
+	if (recorder)
+	{
+		recorder->Shutdown();
+		if (recorder->GetDroppedSamples() > 0)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Telemetry: dropped %d samples writing %s"), recorder->GetDroppedSamples(), *recorder->GetFilePath());
+		}
+		recorder.Reset();
+	}
+	Super::Deinitialize();
+}
@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HitboxModel.generated.h"
+
+/**
+ * One hit shape relative to the player root. A HalfHeight of 0 is a sphere, anything else is a
+ * capsule whose segment runs HalfHeight up and down the local Z axis from LocalOffset.
+ */
+USTRUCT(BlueprintType)
+struct FHitboxShape
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, Category = "Hitbox")
+		FName Name;
+
+	UPROPERTY(EditAnywhere, Category = "Hitbox")
+		FVector LocalOffset = FVector::ZeroVector;
+
+	UPROPERTY(EditAnywhere, Category = "Hitbox")
+		float Radius = 10.f;
+
+	UPROPERTY(EditAnywhere, Category = "Hitbox")
+		float HalfHeight = 0.f;
+};
+
+struct FHitboxPose
+{
+	FVector location = FVector::ZeroVector;
+	float yaw = 0.f;
+};
+
+struct FHitboxHit
+{
+	int32 owner = INDEX_NONE;
+	int32 shape = INDEX_NONE;
+	float distance = 0.f;
+};
+
+/**
+ * Tests one ray against every shape of every posed player in a single pass. Shapes are stored as
+ * structure of arrays in floats relative to the ray origin so the loop has no branches and vectorizes.
+ */
+class LATENCYMITIGATION_API FHitboxQuery
+{
+public:
+	FHitboxQuery(const FVector& inRayStart, const FVector& inRayEnd);
+
+	void AddShapes(const TArray<FHitboxShape>& shapes, const FHitboxPose& pose, int32 owner);
+
+	// Returns true and the closest hit along the ray if any shape was hit
+	bool Raycast(FHitboxHit& outHit) const;
+
+private:
+	FVector rayStart;
+	FVector3f rayDelta;
+
+	TArray<float> segmentX;
+	TArray<float> segmentY;
+	TArray<float> segmentZ;
+	TArray<float> axisZ;
+	TArray<float> radius;
+	TArray<int32> owners;
+	TArray<int32> shapes;
+};
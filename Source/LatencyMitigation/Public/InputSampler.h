@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FPlayerMove;
+
+enum class EInputSampleAxis : uint8
+{
+	Forward,
+	Right,
+	Turn,
+	LookUp,
+	Count
+};
+
+/**
+ * Collects every axis sample delivered between two moves instead of keeping only the latest value per axis.
+ * Look deltas are summed exactly, movement axes are summed and clamped so several sources driving the same
+ * axis in one frame cannot exceed full input. Samples are timestamped so the move knows how old its input is.
+ */
+class LATENCYMITIGATION_API FInputSampler
+{
+public:
+	void AddSample(EInputSampleAxis axis, float value);
+	void AddSample(EInputSampleAxis axis, float value, double sampleTime);
+
+	bool HasSamples() const { return numSamples > 0; }
+	uint32 GetNumSamples() const { return numSamples; }
+
+	// Platform time of the oldest sample not yet flushed
+	double GetFirstSampleTime() const { return firstSampleTime; }
+
+	// Moves everything accumulated since the last flush into the axes of move
+	void Flush(FPlayerMove& move);
+
+private:
+	float sums[int32(EInputSampleAxis::Count)] = {};
+	uint32 numSamples = 0;
+	double firstSampleTime = 0.0;
+};
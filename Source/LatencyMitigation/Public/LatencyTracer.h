@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "LatencyTracer.generated.h"
+
+enum class ELatencyStage : uint8
+{
+	InputToSend,
+	NetworkRoundTrip,
+	ServerReceiveToApply,
+	ServerApplyToAck,
+	ReceiveToReconcile,
+	ReconcileToRender,
+	Total,
+	Count
+};
+
+USTRUCT(BlueprintType)
+struct FLatencyStageSummary
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Latency")
+		FName Stage;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Latency")
+		int32 Count = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Latency")
+		float P50Ms = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Latency")
+		float P95Ms = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Latency")
+		float P99Ms = 0.f;
+};
+
+/**
+ * Client side tracker for traced moves and shots. Client stages use the local platform clock and server
+ * stages are measured on the server and sent back as durations in the ack, so the clocks never need to agree.
+ * The network stage is the round trip minus the time the server held the input.
+ * Durations go into log spaced histograms per stage, about 5% wide from 0.05 ms to over 10 s, so percentiles
+ * are cheap to read at any time and spikes keep their size.
+ */
+class LATENCYMITIGATION_API FLatencyTracer
+{
+public:
+	FLatencyTracer();
+
+	// Returns the trace id to send with the input
+	uint32 BeginTrace(double sampleTime);
+	void MarkSent(uint32 traceId);
+	void MarkReceived(uint32 traceId, float serverReceiveToApplyMs, float serverApplyToAckMs);
+	void MarkReconciled(uint32 traceId);
+
+	// Call once the frame showing the reconciled state has been submitted
+	void CompleteRenderedTraces();
+
+	void GetSummaries(TArray<FLatencyStageSummary>& outSummaries) const;
+	void PublishStats() const;
+	void ResetHistograms();
+
+private:
+	// Bucket 0 holds everything below MinBucketMs, each following bucket is BucketGrowth times wider
+	static constexpr float MinBucketMs = 0.05f;
+	static constexpr float BucketGrowth = 1.05f;
+	static constexpr int32 NumBuckets = 256;
+
+	struct FTrace
+	{
+		double sampleTime = 0.0;
+		double sendTime = 0.0;
+		double receiveTime = 0.0;
+		double reconcileTime = 0.0;
+		float serverReceiveToApplyMs = 0.f;
+		float serverApplyToAckMs = 0.f;
+	};
+
+	void AddSample(ELatencyStage stage, double ms);
+	float GetPercentile(ELatencyStage stage, float percentile) const;
+	static int32 GetBucket(double ms);
+	static float GetBucketUpperMs(int32 bucket);
+
+	TMap<uint32, FTrace> activeTraces;
+	TArray<uint32> awaitingRender;
+	uint32 nextTraceId = 1;
+
+	TArray<uint32> histograms[int32(ELatencyStage::Count)];
+	uint32 counts[int32(ELatencyStage::Count)] = {};
+};
@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Framework/Application/IInputProcessor.h"
+
+class UGameViewportClient;
+
+struct FMouseSample
+{
+	double time = 0.0;
+	FVector2D delta = FVector2D::ZeroVector;
+};
+
+/**
+ * Slate input preprocessor that sees every raw mouse move event before the viewport folds them into the
+ * MouseX/MouseY axes for the frame. Each event is kept with its own delta and the time it was handled.
+ * Only events while the game viewport has mouse capture are kept, and none are consumed.
+ */
+class LATENCYMITIGATION_API FMouseInputProcessor : public IInputProcessor
+{
+public:
+	explicit FMouseInputProcessor(UGameViewportClient* inViewportClient);
+
+	virtual void Tick(const float DeltaTime, FSlateApplication& SlateApp, TSharedRef<ICursor> Cursor) override {}
+	virtual bool HandleMouseMoveEvent(FSlateApplication& SlateApp, const FPointerEvent& MouseEvent) override;
+
+	TArray<FMouseSample> TakeSamples() { return MoveTemp(samples); }
+
+private:
+	TWeakObjectPtr<UGameViewportClient> viewportClient;
+	TArray<FMouseSample> samples;
+};
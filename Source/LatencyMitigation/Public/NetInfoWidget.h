@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "Blueprint/UserWidget.h"
+#include "LatencyTracer.h"
 #include "NetInfoWidget.generated.h"
 
 /**
@@ -26,4 +27,7 @@ public:
 
 	UFUNCTION(BlueprintCallable, BlueprintImplementableEvent, Category = "UpdateInfo")
 		void UpdateSentMoves(int64 numSent);
+
+	UFUNCTION(BlueprintCallable, BlueprintImplementableEvent, Category = "UpdateInfo")
+		void UpdateLatencyStages(const TArray<FLatencyStageSummary>& stages);
 };
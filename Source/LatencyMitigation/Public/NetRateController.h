@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NetRateController.generated.h"
+
+class UNetConnection;
+
+USTRUCT(BlueprintType)
+struct FNetRateSettings
+{
+	GENERATED_BODY()
+
+	// Fastest rate the controller may send at, 0 sends every frame
+	UPROPERTY(EditAnywhere, Category = "Rate")
+		float MinInterval = 0.f;
+
+	UPROPERTY(EditAnywhere, Category = "Rate")
+		float MaxInterval = 0.1f;
+
+	UPROPERTY(EditAnywhere, Category = "Rate")
+		float InitialInterval = 0.f;
+
+	// Interval is multiplied by this on congestion and reduced by RecoveryStep every clean control period
+	UPROPERTY(EditAnywhere, Category = "Rate")
+		float BackoffFactor = 1.5f;
+
+	UPROPERTY(EditAnywhere, Category = "Rate")
+		float RecoveryStep = 0.005f;
+
+	UPROPERTY(EditAnywhere, Category = "Rate")
+		float ControlPeriod = 0.25f;
+
+	// Outgoing bytes per second on the connection before it counts as congested
+	UPROPERTY(EditAnywhere, Category = "Rate")
+		int32 BandwidthTarget = 16000;
+
+	// Average packet loss (0-1) before it counts as congested
+	UPROPERTY(EditAnywhere, Category = "Rate")
+		float LossThreshold = 0.1f;
+
+	// Smoothed RTT above the lowest seen RTT by this fraction counts as queueing
+	UPROPERTY(EditAnywhere, Category = "Rate")
+		float RttRiseThreshold = 0.5f;
+
+	UPROPERTY(EditAnywhere, Category = "Redundancy")
+		int32 MinRedundancy = 0;
+
+	UPROPERTY(EditAnywhere, Category = "Redundancy")
+		int32 MaxRedundancy = 4;
+
+	// Extra copies of each unacked move per 1% of measured loss
+	UPROPERTY(EditAnywhere, Category = "Redundancy")
+		float RedundancyPerLossPercent = 0.2f;
+};
+
+/**
+ * Per connection AIMD controller. Backs off the send interval when the connection shows loss, a rising RTT,
+ * saturation or is over its bandwidth target, and slowly speeds back up while it is clean.
+ * Redundancy follows measured loss but is dropped to the minimum while over the bandwidth target.
+ */
+class LATENCYMITIGATION_API FNetRateController
+{
+public:
+	void Initialize(const FNetRateSettings& inSettings);
+
+	// Returns true when it is time to send with the current interval
+	bool Update(float DeltaTime, UNetConnection* connection);
+
+	float GetSendInterval() const { return sendInterval; }
+
+	// Multiplies the interval chosen by the controller, used to shed load on the sender
+	float GetIntervalScale() const { return intervalScale; }
+	void SetIntervalScale(float scale) { intervalScale = FMath::Max(scale, 1.f); }
+	int32 GetRedundancy() const { return redundancy; }
+	float GetSmoothedRtt() const { return smoothedRtt; }
+	float GetLoss() const { return loss; }
+
+private:
+	void Adjust(UNetConnection* connection);
+
+	FNetRateSettings settings{};
+	float sendInterval = 0.f;
+	float intervalScale = 1.f;
+	int32 redundancy = 0;
+	float timeSinceSend = 0.f;
+	float timeSinceAdjust = 0.f;
+
+	float smoothedRtt = 0.f;
+	float minRtt = 0.f;
+	float loss = 0.f;
+};
@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NetSessionStats.generated.h"
+
+/**
+ * Netcode quality counters for one player over a measurement window.
+ * Client side fields are accumulated on the owning client and sent to the server as deltas.
+ */
+USTRUCT()
+struct FNetSessionStats
+{
+	GENERATED_BODY()
+
+	// Server side
+	UPROPERTY();
+	uint32 movesReceived = 0;
+
+	UPROPERTY();
+	uint32 shotsValidated = 0;
+
+	UPROPERTY();
+	uint32 serverHits = 0;
+
+	// Client side
+	UPROPERTY();
+	uint32 acksReceived = 0;
+
+	UPROPERTY();
+	uint32 corrections = 0;
+
+	UPROPERTY();
+	float mispredictionErrorSum = 0.f;
+
+	UPROPERTY();
+	float mispredictionErrorMax = 0.f;
+
+	UPROPERTY();
+	uint32 shotsResolved = 0;
+
+	UPROPERTY();
+	uint32 shotsAgreed = 0;
+
+	void AddClientStats(const FNetSessionStats& other)
+	{
+		acksReceived += other.acksReceived;
+		corrections += other.corrections;
+		mispredictionErrorSum += other.mispredictionErrorSum;
+		mispredictionErrorMax = FMath::Max(mispredictionErrorMax, other.mispredictionErrorMax);
+		shotsResolved += other.shotsResolved;
+		shotsAgreed += other.shotsAgreed;
+	}
+};
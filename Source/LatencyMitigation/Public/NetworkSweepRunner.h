@@ -0,0 +1,181 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "NetSessionStats.h"
+#include "ServerFrameTimer.h"
+#include "NetworkSweepRunner.generated.h"
+
+class APlayerCharacter;
+class UNetConnection;
+
+/**
+ * One network condition to emulate on every client connection. Values follow FPacketSimulationSettings and are
+ * applied on both the server and the client end, so lag, loss, duplication and reordering affect both directions.
+ */
+USTRUCT(BlueprintType)
+struct FNetEmulationProfile
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, Category = "Profile")
+		FString Name = TEXT("Default");
+
+	// Lag in ms added by each end to the packets it sends, randomised by +/- PktLagVariance ms
+	UPROPERTY(EditAnywhere, Category = "Profile")
+		int32 PktLag = 0;
+
+	UPROPERTY(EditAnywhere, Category = "Profile")
+		int32 PktLagVariance = 0;
+
+	// Percent of packets each end drops when sending
+	UPROPERTY(EditAnywhere, Category = "Profile")
+		int32 PktLoss = 0;
+
+	// Percent of packets each end drops when receiving
+	UPROPERTY(EditAnywhere, Category = "Profile")
+		int32 PktIncomingLoss = 0;
+
+	// Percent of packets each end sends twice
+	UPROPERTY(EditAnywhere, Category = "Profile")
+		int32 PktDup = 0;
+
+	// Send packets out of order
+	UPROPERTY(EditAnywhere, Category = "Profile")
+		bool PktOrder = false;
+
+	// Jitter in ms each end adds on top of lag
+	UPROPERTY(EditAnywhere, Category = "Profile")
+		int32 PktJitter = 0;
+};
+
+/**
+ * Aggregated results of one profile run.
+ */
+USTRUCT(BlueprintType)
+struct FNetSweepResult
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, Category = "Result")
+		FNetEmulationProfile Profile;
+
+	UPROPERTY(VisibleAnywhere, Category = "Result")
+		int32 NumPlayers = 0;
+
+	UPROPERTY(VisibleAnywhere, Category = "Result")
+		float AvgMispredictionError = 0.f;
+
+	UPROPERTY(VisibleAnywhere, Category = "Result")
+		float MaxMispredictionError = 0.f;
+
+	// Fraction of received acks that moved the client by more than the correction tolerance
+	UPROPERTY(VisibleAnywhere, Category = "Result")
+		float CorrectionRate = 0.f;
+
+	// Fraction of shots where the server verdict matched what the shooter saw
+	UPROPERTY(VisibleAnywhere, Category = "Result")
+		float HitRegAccuracy = 0.f;
+
+	UPROPERTY(VisibleAnywhere, Category = "Result")
+		float MovesPerSecond = 0.f;
+
+	UPROPERTY(VisibleAnywhere, Category = "Result")
+		float AvgInKBps = 0.f;
+
+	UPROPERTY(VisibleAnywhere, Category = "Result")
+		float AvgOutKBps = 0.f;
+
+	UPROPERTY(VisibleAnywhere, Category = "Result")
+		float AvgServerFrameMs = 0.f;
+
+	UPROPERTY(VisibleAnywhere, Category = "Result")
+		float MaxServerFrameMs = 0.f;
+};
+
+/**
+ * Server side actor that walks through a list of network emulation profiles, applies each one to every
+ * client connection, drives the connected players through a scripted session and writes a comparison report.
+ * Packet simulation is only compiled into non-shipping builds.
+ */
+UCLASS()
+class LATENCYMITIGATION_API ANetworkSweepRunner : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ANetworkSweepRunner();
+
+	virtual void Tick(float DeltaTime) override;
+
+	UFUNCTION(BlueprintCallable, Category = "Network Sweep")
+		void StartSweep();
+
+	UFUNCTION(BlueprintCallable, Category = "Network Sweep")
+		void StopSweep();
+
+	UFUNCTION(BlueprintCallable, Category = "Network Sweep")
+		bool IsRunning() const { return currentProfile != INDEX_NONE; }
+
+	static void ApplyProfileToConnection(UNetConnection* connection, const FNetEmulationProfile& profile);
+
+	UPROPERTY(EditAnywhere, Category = "Network Sweep")
+		TArray<FNetEmulationProfile> Profiles;
+
+	UPROPERTY(EditAnywhere, Category = "Network Sweep")
+		bool StartOnBeginPlay = false;
+
+	// Time given to each profile to settle before measuring
+	UPROPERTY(EditAnywhere, Category = "Network Sweep")
+		float WarmupDuration = 2.0f;
+
+	UPROPERTY(EditAnywhere, Category = "Network Sweep")
+		float ProfileDuration = 30.0f;
+
+	// Time allowed after the measured window for the clients' final stats to arrive, must cover the emulated round trip
+	UPROPERTY(EditAnywhere, Category = "Network Sweep")
+		float CollectDuration = 2.0f;
+
+	// Clients fire at this interval during the scripted session, 0 disables firing
+	UPROPERTY(EditAnywhere, Category = "Network Sweep")
+		float ScriptedFireInterval = 0.5f;
+
+	// Report is written to Saved/<ReportDirectory>
+	UPROPERTY(EditAnywhere, Category = "Network Sweep")
+		FString ReportDirectory = TEXT("NetSweep");
+
+	UPROPERTY(VisibleAnywhere, Category = "Network Sweep")
+		TArray<FNetSweepResult> Results;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	void BeginProfile(int32 profileIndex);
+	void BeginMeasuring();
+	void EndMeasuring();
+	void FinishProfile();
+	void ApplyProfile(const FNetEmulationProfile& profile);
+	void SetScriptedSession(bool enabled);
+	void GetPlayers(TArray<APlayerCharacter*>& outPlayers) const;
+	void WriteReport() const;
+
+	int32 currentProfile = INDEX_NONE;
+	float profileTime = 0.f;
+	bool measuring = false;
+	bool collecting = false;
+
+	// Server side counters frozen at the end of the measured window
+	FNetSessionStats serverTotals{};
+	int32 measuredPlayers = 0;
+	FServerFrameTimer frameTimer;
+
+	uint32 samples = 0;
+	double inBytesPerSecondSum = 0.0;
+	double outBytesPerSecondSum = 0.0;
+	double serverFrameMsSum = 0.0;
+	float serverFrameMsMax = 0.f;
+};
@@ -8,6 +8,24 @@
 #include "NetworkedPlayerController.h"
 #include "NetworkedGameMode.generated.h"
 
+/**
+ * One small match hosted in this server process. Players only see, hit and replicate to others in the same match.
+ */
+USTRUCT()
+struct FMatchInstance
+{
+    GENERATED_BODY()
+
+    UPROPERTY()
+    int32 MatchId = 0;
+
+    UPROPERTY()
+    TArray<APlayerController*> Players;
+
+    UPROPERTY()
+    int32 NextColorIndex = 0;
+};
+
 /**
  * 
  */
@@ -20,9 +38,21 @@ public:
     UPROPERTY(EditDefaultsOnly, Category = "Player Colors")
     TArray<FLinearColor> DefaultPlayerColors;
 
+    // New players join the first match with room, a new match is opened when all are full
+    UPROPERTY(EditDefaultsOnly, Category = "Matches")
+    int32 MaxPlayersPerMatch = 8;
+
     // Override the function to handle starting a new player
     virtual void PostLogin(APlayerController* NewPlayer) override;
-    TArray<APlayerController*> playersList {};
+    virtual void Logout(AController* Exiting) override;
+
+    const TArray<FMatchInstance>& GetMatches() const { return matches; }
+
 private:
-    int8 playersConnected = 0;
+    FMatchInstance& FindOrCreateMatch();
+
+    UPROPERTY()
+    TArray<FMatchInstance> matches;
+
+    int32 nextMatchId = 0;
 };
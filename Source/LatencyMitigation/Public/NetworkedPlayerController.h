@@ -4,14 +4,82 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/PlayerController.h"
+#include "NetRateController.h"
+#include "LatencyTracer.h"
 #include "NetworkedPlayerController.generated.h"
 
+class APlayerCharacter;
+
+/**
+ * Position of one other player as seen by the server, sent to clients that only simulate that player.
+ */
+USTRUCT()
+struct FProxySnapshot
+{
+	GENERATED_BODY()
+
+	UPROPERTY();
+	APlayerCharacter* player = nullptr;
+
+	UPROPERTY();
+	double timestamp = 0.f;
+
+	UPROPERTY();
+	FVector location{};
+
+	UPROPERTY();
+	float yaw = 0.f;
+
+	UPROPERTY();
+	float pitch = 0.f;
+};
+
 /**
- * 
+ * On the server each remote controller schedules the snapshots of the other players its client sees, at the
+ * rate its own connection can take. The owner's acks are sent by the pawn and do not go through here.
  */
 UCLASS()
 class LATENCYMITIGATION_API ANetworkedPlayerController : public APlayerController
 {
 	GENERATED_BODY()
 
+public:
+	ANetworkedPlayerController();
+
+	virtual void Tick(float DeltaTime) override;
+
+	UFUNCTION(Client, Unreliable)
+		void ClientReceiveSnapshots(const TArray<FProxySnapshot>& snapshots);
+
+	virtual void ClientReceiveSnapshots_Implementation(const TArray<FProxySnapshot>& snapshots);
+
+	// The match lives on the controller so it survives respawns, every pawn it possesses is moved into it
+	int32 GetMatchId() const { return matchId; }
+	void SetMatch(int32 newMatchId, TOptional<FLinearColor> newColor);
+	void ApplyMatchTo(APlayerCharacter* pawn) const;
+
+	// Only the local player's controller on a client traces latency, created on first use
+	FLatencyTracer* GetLatencyTracer();
+
+	float GetSnapshotIntervalScale() const { return snapshotRateController.GetIntervalScale(); }
+	void SetSnapshotIntervalScale(float scale) { snapshotRateController.SetIntervalScale(scale); }
+
+	// Rate this client receives other players' snapshots at
+	UPROPERTY(EditAnywhere, Category = "Rate Control")
+		FNetRateSettings SnapshotRateSettings;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	void SendSnapshots();
+	void OnEndFrame();
+
+	FNetRateController snapshotRateController;
+	int32 matchId = 0;
+	TOptional<FLinearColor> matchColor;
+
+	TUniquePtr<FLatencyTracer> latencyTracer;
+	FDelegateHandle endFrameHandle;
 };
@@ -11,11 +11,22 @@
 #include "NetworkedPlayerController.h"
 #include "Net/UnrealNetwork.h"
 #include "NetInfoWidget.h"
+#include "NetSessionStats.h"
+#include "NetworkSweepRunner.h"
+#include "NetRateController.h"
+#include "TelemetrySubsystem.h"
+#include "PlayerRegistrySubsystem.h"
+#include "HitboxModel.h"
+#include "RollbackHistory.h"
+#include "InputSampler.h"
+#include "MouseInputProcessor.h"
+#include "LatencyTracer.h"
 #include "Engine/NetConnection.h"
 #include "UMG/Public/UMG.h"
 #include <queue>
-#include <list>
+#include <deque>
 #include "PlayerCharacter.generated.h"
+
 USTRUCT()
 struct FPlayerMove
 {
@@ -38,6 +49,17 @@ struct FPlayerMove
 	
 	UPROPERTY();
 	float lookAtRotation = 0.f;
+
+	// Non zero on the sampled moves the client traces end to end
+	UPROPERTY();
+	uint32 traceID = 0;
+};
+
+struct FPlayerMovementState
+{
+	FVector location = FVector::ZeroVector;
+	float yaw = 0.f;
+	float pitch = 0.f;
 };
 
 USTRUCT()
@@ -59,6 +81,16 @@ struct FServerMoveAck
 
 	UPROPERTY();
 	float lookAtRotation = 0.f;
+
+	// Trace completed by this ack, with the time the server held it
+	UPROPERTY();
+	uint32 traceID = 0;
+
+	UPROPERTY();
+	float serverReceiveToApplyMs = 0.f;
+
+	UPROPERTY();
+	float serverApplyToAckMs = 0.f;
 };
 
 USTRUCT()
@@ -74,6 +106,35 @@ public:
 
 	UPROPERTY();
 	FVector EndRay{};
+
+	UPROPERTY();
+	double shotTimestamp = 0.f;
+
+	UPROPERTY();
+	uint32 traceID = 0;
+
+	UPROPERTY();
+	float serverReceiveToApplyMs = 0.f;
+
+	UPROPERTY();
+	float serverApplyToAckMs = 0.f;
+
+	// The server dropped the shot without validating it, too old to rewind or queued too long under load
+	UPROPERTY();
+	bool rejected = false;
+};
+
+// Shot as received by the server, kept until it is resolved
+struct FPendingShot
+{
+	double timestamp = 0.0;
+	uint32 traceID = 0;
+	// Last move the client sent before firing, the shot waits until the server has applied it
+	uint32 moveID = 0;
+	double receiveTime = 0.0;
+	// Aim once the shot's move is applied, filled in when the shot is validated
+	FVector start = FVector::ZeroVector;
+	FVector end = FVector::ZeroVector;
 };
 
 USTRUCT()
@@ -84,6 +145,9 @@ public:
 	UPROPERTY();
 	FVector OtherPlayerLocation {};
 
+	UPROPERTY();
+	float OtherPlayerYaw = 0.f;
+
 	UPROPERTY();
 	FColor DrawColor = FColor::Red;
 };
@@ -101,6 +165,7 @@ public:
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:
 	// Called every frame
@@ -109,6 +174,12 @@ public:
 	// Called to bind functionality to input
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 
+	// Takes the match and color stored on the possessing controller
+	virtual void PossessedBy(AController* NewController) override;
+
+	// Players are only replicated to viewers in the same match
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
+
 	// Player Actions
 	void MoveForward(float Axis);
 	void MoveRight(float Axis);
@@ -119,11 +190,12 @@ public:
 
 	void GetNetworkEmulationSettings();
 
+	// Carries every move since the last send plus a few already sent but unacked moves as redundancy
 	UFUNCTION(Server, Unreliable)
-		void ServerMove(FPlayerMove input);
+		void ServerMove(const TArray<FPlayerMove>& moves);
 	
 	UFUNCTION(Server, Unreliable)
-		void ServerFire(double timestamp);
+		void ServerFire(double timestamp, uint32 traceID, uint32 moveID);
 
 	UFUNCTION(Client, Unreliable)
 	virtual void ClientFireResponse(FServerFireAck ack);
@@ -134,15 +206,29 @@ public:
 	UFUNCTION(Client, Unreliable)
 	virtual void ClientDebugResponse(FServerDrawDebug debugInfo);
 
-	UFUNCTION(NetMulticast, Unreliable)
-		void MulticastReconcileMove(FServerMoveAck ack);
+	// Server state after the owner's newest applied move, sent to the owner only
+	UFUNCTION(Client, Unreliable)
+		void ClientAckMove(FServerMoveAck ack);
+
+	UFUNCTION(Server, Reliable)
+		void ServerReportNetStats(FNetSessionStats clientStats);
+
+	UFUNCTION(Client, Reliable)
+		void ClientSetScriptedSession(bool enabled, float fireInterval);
+
+	// Sends the stats counted since the last report, or drops them when discard is set
+	UFUNCTION(Client, Reliable)
+		void ClientFlushNetStats(bool discard);
+
+	UFUNCTION(Client, Reliable)
+		void ClientSetNetEmulation(FNetEmulationProfile profile);
 
 	UFUNCTION()
 		void OnRep_PlayerColor();
 	
-	virtual void ServerMove_Implementation(FPlayerMove input);
+	virtual void ServerMove_Implementation(const TArray<FPlayerMove>& moves);
 
-	virtual void ServerFire_Implementation(double timestamp);
+	virtual void ServerFire_Implementation(double timestamp, uint32 traceID, uint32 moveID);
 
 	virtual void ClientFireResponse_Implementation(FServerFireAck ack);
 
@@ -150,10 +236,51 @@ public:
 
 	virtual void ClientDebugResponse_Implementation(FServerDrawDebug debugInfo);
 
-	virtual void MulticastReconcileMove_Implementation(FServerMoveAck ack);
+	virtual void ClientAckMove_Implementation(FServerMoveAck ack);
+
+	// Snapshot for a simulated proxy, scheduled per receiving connection by ANetworkedPlayerController
+	void ReceiveProxySnapshot(const FProxySnapshot& snapshot);
+
+	virtual void ServerReportNetStats_Implementation(FNetSessionStats clientStats);
+
+	virtual void ClientSetScriptedSession_Implementation(bool enabled, float fireInterval);
+
+	virtual void ClientFlushNetStats_Implementation(bool discard);
+
+	virtual void ClientSetNetEmulation_Implementation(FNetEmulationProfile profile);
 
 	void SetPlayerColor(const FLinearColor& newColor);
 
+	int32 GetMatchId() const { return matchId; }
+	void SetMatchId(int32 newMatchId);
+
+	// Pure movement step shared by client prediction and the server, safe to run off the game thread
+	static FPlayerMovementState SimulateMove(const FPlayerMovementState& state, const FPlayerMove& move, float movementSpeed, float turnSpeed);
+
+	FPlayerMovementState GetMovementState() const;
+	bool HasPendingServerMoves() const;
+	TArray<FPlayerMove> TakePendingServerMoves() { return MoveTemp(pendingServerMoves); }
+	void CommitServerMoves(const FPlayerMovementState& state, uint32 lastMoveId, int32 numMoves);
+
+	// Shot validation hooks for UServerShotProcessor
+	bool HasAppliedMove(uint32 moveID) const { return lastAppliedMoveId >= moveID; }
+	void GetShotRay(FVector& outStart, FVector& outEnd) const;
+	FVector TraceLevel(const FVector& StartVector, const FVector& EndVector) const;
+	FHitboxPose GetCurrentPose() const;
+	bool SampleHistoricalPose(double timestamp, FHitboxPose& outPose) const;
+	void CommitShot(const FPendingShot& shot, APlayerCharacter* hitPlayer, const TArray<APlayerCharacter*>& targets, const TArray<FHitboxPose>& rewoundPoses);
+	void RejectShot(const FPendingShot& shot);
+	bool CanRewindTo(double timestamp) const;
+	double GetLastFireTime() const { return lastServerFireTime; }
+	double GetLastHitTime() const { return lastServerHitTime; }
+
+	// Load governor hook, multiplier on RollbackWindow
+	float GetRollbackWindowScale() const { return rollbackWindowScale; }
+	void SetRollbackWindowScale(float scale) { rollbackWindowScale = scale; }
+
+	const FNetSessionStats& GetNetSessionStats() const { return netStats; }
+	void ResetNetSessionStats();
+
 	UFUNCTION(BlueprintCallable, BlueprintImplementableEvent, Category = "NetInfo")
 		void UpdateWidget_ClientInfo(const FVector& clientPosition);
 
@@ -166,6 +293,9 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintImplementableEvent, Category = "NetInfo")
 		void UpdateWidget_ServerInfo(const FVector& serverPosition);
 
+	UFUNCTION(BlueprintCallable, BlueprintImplementableEvent, Category = "NetInfo")
+		void UpdateWidget_LatencyStages(const TArray<FLatencyStageSummary>& stages);
+
 	UFUNCTION(BlueprintImplementableEvent, Category = "HitWidget")
 		void UpdateWidget_LandedHit();
 
@@ -179,8 +309,29 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Movement")
 		float TurnSpeed = 1.0f;
 
+	// Seconds of pose history kept for rewinding shots
 	UPROPERTY(EditAnywhere, Category = "Movement")
-		uint32 numRollbackPositions = 10;
+		float RollbackWindow = 1.0f;
+
+	// Client move upload rate and redundancy
+	UPROPERTY(EditAnywhere, Category = "Rate Control")
+		FNetRateSettings MoveRateSettings;
+
+	// Server ack rate to the owning client
+	UPROPERTY(EditAnywhere, Category = "Rate Control")
+		FNetRateSettings AckRateSettings;
+
+	// Moves per ServerMove RPC, more new moves are split over several RPCs and larger arrays are ignored by the server
+	UPROPERTY(EditAnywhere, Category = "Rate Control")
+		int32 MaxMovesPerPacket = 32;
+
+	// Moves the server keeps waiting to be applied, newer ones beyond this are dropped
+	UPROPERTY(EditAnywhere, Category = "Rate Control")
+		int32 MaxPendingServerMoves = 128;
+
+	// When moves arrive with a gap before them the server waits this long for the missing ones before applying
+	UPROPERTY(EditAnywhere, Category = "Rate Control")
+		float MoveGapHoldTime = 0.02f;
 
 
 	UPROPERTY(ReplicatedUsing = OnRep_PlayerColor)
@@ -193,6 +344,10 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Shooting")
 		bool DrawDebug = false;
 
+	// Shots are validated against these shapes at the shooter's timestamp instead of the actor collision
+	UPROPERTY(EditAnywhere, Category = "Shooting")
+		TArray<FHitboxShape> Hitboxes;
+
 
 	UPROPERTY(EditAnywhere, Category = "Dummy Player")
 		float TotalDummyMoveTime = 5.0f;
@@ -200,6 +355,21 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Dummy Player")
 		float DummyInputRate = 0.1f;
 
+	// Reconcile corrections smaller than this are not counted as mispredictions
+	UPROPERTY(EditAnywhere, Category = "Net Stats")
+		float CorrectionTolerance = 0.1f;
+
+	UPROPERTY(EditAnywhere, Category = "Net Stats")
+		float NetStatsReportInterval = 1.0f;
+
+	// Every Nth move is traced from input sampling to render, 0 disables move tracing. Shots are always traced.
+	UPROPERTY(EditAnywhere, Category = "Net Stats")
+		int32 TraceEveryNthMove = 10;
+
+	// Stage percentiles are published and reset at this interval
+	UPROPERTY(EditAnywhere, Category = "Net Stats")
+		float LatencyReportInterval = 2.0f;
+
 	UPROPERTY(EditAnywhere)
 		UStaticMeshComponent* PlayerMesh;
 
@@ -211,22 +381,25 @@ public:
 private:
 	void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 	void ApplyMovement(const FPlayerMove& move);
-	void DrawCollider(const FVector& colliderPosition, const FColor& color = FColor::Red);
-	void RewindPlayerPosition(double timestamp);
-	void RestorePlayerPosition();
-
-	bool bMoveOnForwardAxis = false;
-	bool bMoveOnRightAxis = false;
-	bool bMoveLookAt = false;
-	bool bMovePlayerRot = false;
-	bool bMovementToSend = false;
-	float forwardAxis = 0.f;
-	float rightAxis = 0.f;
-	float lookAtAxis = 0.f;
-	float playerRotAxis = 0.f;
-
-	FVector oldestServerPosition{};
-	std::queue<FVector> serverPositionsToSimulate;
+	void SetMovementState(const FPlayerMovementState& state);
+	void DrawCollider(const FHitboxPose& pose, const FColor& color = FColor::Red);
+	FHitboxPose GetHistoricalPose(double timestamp) const;
+	void SendPendingMoves(bool resendUnacked = false);
+	bool ShouldResendMoves() const;
+	void RecordServerUpdate();
+	void RecordTelemetry(ETelemetrySeries series, float value);
+	FLatencyTracer* GetLatencyTracer() const;
+	void ReportLatencyStages();
+	void AddMouseSamples();
+	float GetMouseAxisScale(APlayerController* playerController, FName axisName, const FKey& key) const;
+	void FlushInputToMove();
+	APlayerCharacter* TraceShot(FVector StartVector, FVector EndVector) const;
+
+	FInputSampler inputSampler;
+	TSharedPtr<FMouseInputProcessor> mouseProcessor;
+
+	FServerMoveAck oldestServerState{};
+	std::queue<FServerMoveAck> serverPositionsToSimulate;
 	float simulatedRotation = 0.f;
 	float simulatedForwardSpeed = 0.f;
 	float simulatedRightSpeed = 0.f;
@@ -235,22 +408,52 @@ private:
 
 	uint32 nextMoveId = 1;
 	
-	std::queue<FPlayerMove> serverMovesToApply;
-	std::queue<FPlayerMove> nonAckedMoves;
+	// Moves received this frame, applied by UServerMoveProcessor before actors tick
+	TArray<FPlayerMove> pendingServerMoves;
+	std::deque<FPlayerMove> nonAckedMoves;
+	uint32 lastSentMoveId = 0;
+	double lastMoveSendTime = 0.0;
+	uint32 lastAppliedMoveId = 0;
+	double pendingMovesSince = 0.0;
 
-	float serverUpdateCounter = 0.f;
+	FNetRateController moveRateController;
+	FNetRateController ackRateController;
 
 	bool dummy = false;
 	float dummyMovementTime = 0.f;
 	float timeSinceDummyInput = 0.f;
 	bool movingRight = true;
 
-	float halfHeight = 0.f;
-	float radius = 0.f;
-
-	std::list<FServerMoveAck> rollbackPositions;
-	bool rolledBack = false;
-	FVector cachedRollbackPosition{};
+	FRollbackHistory rollbackHistory;
+	float rollbackWindowScale = 1.f;
 	FServerMoveAck nextServerUpdate{};
 	bool freshPlayerInput = false;
+
+	FNetSessionStats netStats{};
+	FNetSessionStats clientNetStats{};
+	float netStatsReportCounter = 0.f;
+	TArray<TPair<double, bool>> pendingShotPredictions;
+
+	uint32 movesSinceTrace = 0;
+	float latencyReportCounter = 0.f;
+
+	// Server side timing of the move trace currently waiting for its ack
+	uint32 serverTraceId = 0;
+	double serverTraceReceiveTime = 0.0;
+	double serverTraceApplyTime = 0.0;
+
+	UPROPERTY()
+		TObjectPtr<UTelemetrySubsystem> telemetry;
+
+	UPROPERTY()
+		TObjectPtr<UPlayerRegistrySubsystem> registry;
+
+	double lastServerFireTime = -1.0e9;
+	double lastServerHitTime = -1.0e9;
+	int32 registrySlot = INDEX_NONE;
+	int32 matchId = 0;
+
+	bool scriptedSession = false;
+	float scriptedFireInterval = 0.f;
+	float timeSinceScriptedFire = 0.f;
 };
\ No newline at end of file
@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PlayerRegistrySubsystem.generated.h"
+
+class APlayerCharacter;
+class AGameStateBase;
+
+USTRUCT()
+struct FMatchPlayers
+{
+	GENERATED_BODY()
+
+	UPROPERTY();
+	TArray<TObjectPtr<APlayerCharacter>> players;
+};
+
+/**
+ * Keeps a dense array of the live players in the world so hot paths can iterate them without
+ * actor iteration, allocation or casts. Each player also gets a slot that stays the same while
+ * it is registered, even when other players leave and the dense array is compacted.
+ * Players are additionally grouped per match so match local systems only see their own players.
+ * Also caches the game state used as the shared time source.
+ */
+UCLASS()
+class LATENCYMITIGATION_API UPlayerRegistrySubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// Returns the player's slot
+	int32 Register(APlayerCharacter* player);
+	void Unregister(int32 slot);
+
+	const TArray<APlayerCharacter*>& GetPlayers() const { return ToRawPtrTArrayUnsafe(players); }
+	const TArray<APlayerCharacter*>& GetMatchPlayers(int32 matchId) const;
+	void SetPlayerMatch(int32 slot, int32 matchId);
+	APlayerCharacter* GetPlayerInSlot(int32 slot) const;
+
+	AGameStateBase* GetGameState() const { return gameState; }
+	double GetServerWorldTimeSeconds() const;
+
+private:
+	void OnGameStateSet(AGameStateBase* newGameState);
+	void RemoveFromMatch(int32 slot, APlayerCharacter* player);
+
+	UPROPERTY()
+		TArray<TObjectPtr<APlayerCharacter>> players;
+
+	TArray<int32> denseToSlot;
+	TArray<int32> slotToDense;
+	TArray<int32> freeSlots;
+	TArray<int32> slotToMatch;
+
+	UPROPERTY()
+		TMap<int32, FMatchPlayers> matchPlayers;
+
+	UPROPERTY()
+		TObjectPtr<AGameStateBase> gameState;
+
+	FDelegateHandle gameStateSetHandle;
+};
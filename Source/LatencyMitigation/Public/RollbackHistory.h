@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FRollbackSample
+{
+	double timestamp = 0.0;
+	FVector location = FVector::ZeroVector;
+	float yaw = 0.f;
+	float pitch = 0.f;
+};
+
+/**
+ * Server side pose history for rewinding a player.
+ *
+ * Samples are stored in 256 byte, cache line aligned blocks: a full precision keyframe followed by up to
+ * DeltasPerBlock 12 byte entries quantized against it (quarter millisecond time, 1/16 unit position and
+ * 16 bit angles). A new keyframe is started when a block fills or a delta no longer fits.
+ * Only blocks covering the retention window are kept, so memory follows the window length in time.
+ */
+class LATENCYMITIGATION_API FRollbackHistory
+{
+public:
+	void Append(double timestamp, const FVector& location, float yaw, float pitch);
+
+	// Drops blocks that are entirely older than oldestTimestamp, keeping one sample at or before it
+	void Trim(double oldestTimestamp);
+
+	void Reset() { blocks.Reset(); }
+	bool IsEmpty() const { return blocks.Num() == 0; }
+	double GetNewestTimestamp() const;
+
+	// Interpolated sample at timestamp, clamped to the oldest and newest stored samples
+	bool Sample(double timestamp, FRollbackSample& outSample) const;
+
+private:
+	static constexpr int32 DeltasPerBlock = 18;
+	static constexpr double TimeStep = 0.00025;
+	static constexpr double PositionStep = 1.0 / 16.0;
+
+	struct FHistoryDelta
+	{
+		uint16 time;
+		int16 x;
+		int16 y;
+		int16 z;
+		uint16 yaw;
+		uint16 pitch;
+	};
+
+	struct alignas(64) FHistoryBlock
+	{
+		double keyTimestamp;
+		double keyX;
+		double keyY;
+		double keyZ;
+		uint16 keyYaw;
+		uint16 keyPitch;
+		uint16 numDeltas;
+		uint16 padding;
+		FHistoryDelta deltas[DeltasPerBlock];
+	};
+	static_assert(sizeof(FHistoryBlock) == 256, "History blocks should be four cache lines");
+
+	int32 NumSamples(int32 blockIndex) const { return blocks[blockIndex].numDeltas + 1; }
+	FRollbackSample Decode(int32 blockIndex, int32 sampleIndex) const;
+	double DecodeTimestamp(int32 blockIndex, int32 sampleIndex) const;
+	bool TryAppendDelta(FHistoryBlock& block, double timestamp, const FVector& location, float yaw, float pitch);
+
+	TArray<FHistoryBlock, TAlignedHeapAllocator<alignof(FHistoryBlock)>> blocks;
+};
@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Measures the game thread work of each frame of one world, from the start of its tick to the end of the
+ * engine frame. Idle time spent waiting for the next tick is not included. Works without a viewport,
+ * unlike GGameThreadTime which is only updated when a viewport draws.
+ */
+class LATENCYMITIGATION_API FServerFrameTimer
+{
+public:
+	~FServerFrameTimer() { Stop(); }
+
+	void Start(UWorld* inWorld);
+	void Stop();
+
+	float GetLastFrameMs() const { return lastFrameMs; }
+
+private:
+	void OnWorldTickStart(UWorld* tickedWorld, ELevelTick tickType, float deltaSeconds);
+	void OnEndFrame();
+
+	TWeakObjectPtr<UWorld> world;
+	uint64 frameStartCycles = 0;
+	float lastFrameMs = 0.f;
+	FDelegateHandle tickStartHandle;
+	FDelegateHandle endFrameHandle;
+};
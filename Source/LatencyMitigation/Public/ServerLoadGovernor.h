@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PlayerCharacter.h"
+#include "ServerFrameTimer.h"
+#include "ServerLoadGovernor.generated.h"
+
+/**
+ * Watches server game thread time against lm.Governor.FrameBudgetMs and sheds work in steps when it stays over.
+ * Level 1 slows the snapshots sent to viewers that have not fired or been hit recently, level 2 also caps how many
+ * shots are resolved per frame and defers the rest, level 3 also shrinks rollback history. Levels go up and down one
+ * at a time with hysteresis and snapshot rates slew towards their target, so the server degrades gradually instead
+ * of hitching. All tunables are lm.Governor.* console variables.
+ */
+UCLASS()
+class LATENCYMITIGATION_API UServerLoadGovernor : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static constexpr int32 MaxLoadLevel = 3;
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// Shots UServerShotProcessor may validate this frame, the rest wait in its queue
+	int32 GetShotCap() const;
+	int32 GetMaxDeferredShots() const;
+	float GetMaxShotDeferral() const;
+	void NoteDeferredShots(int32 numDeferred, int32 numWaiting);
+	void NoteRejectedShots(int32 numRejected);
+
+	int32 GetLoadLevel() const { return loadLevel; }
+	float GetSmoothedFrameMs() const { return smoothedFrameMs; }
+
+private:
+	void OnWorldTickStart(UWorld* world, ELevelTick tickType, float deltaSeconds);
+	void UpdateLoadLevel(float deltaSeconds);
+	void SetLoadLevel(int32 newLevel);
+	void UpdateSnapshotScales(float deltaSeconds);
+	float GetLowPriorityScale() const;
+	float GetRollbackWindowScale() const;
+
+	FServerFrameTimer frameTimer;
+	int32 loadLevel = 0;
+	float smoothedFrameMs = 0.f;
+	float overBudgetTime = 0.f;
+	float underBudgetTime = 0.f;
+
+	int32 shotsDeferredSinceReport = 0;
+	int32 shotsRejectedSinceReport = 0;
+	int32 shotsWaiting = 0;
+	float reportCounter = 0.f;
+
+	FDelegateHandle tickStartHandle;
+};
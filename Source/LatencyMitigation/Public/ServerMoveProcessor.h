@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PlayerCharacter.h"
+#include "ServerMoveProcessor.generated.h"
+
+/**
+ * Applies the moves every player sent this frame in one batch on the server. Network receive only queues moves,
+ * then before actors tick each player's moves are simulated on worker threads with the pure movement step and
+ * the results are committed back on the game thread in a single pass.
+ */
+UCLASS()
+class LATENCYMITIGATION_API UServerMoveProcessor : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// Below this many players with pending moves the batch runs on the game thread
+	int32 MinParallelPlayers = 4;
+
+private:
+	struct FMoveJob
+	{
+		APlayerCharacter* player = nullptr;
+		FPlayerMovementState state{};
+		TArray<FPlayerMove> moves;
+		float movementSpeed = 0.f;
+		float turnSpeed = 0.f;
+	};
+
+	void OnWorldPreActorTick(UWorld* world, ELevelTick tickType, float deltaSeconds);
+
+	TArray<FMoveJob> jobs;
+	FDelegateHandle preActorTickHandle;
+};
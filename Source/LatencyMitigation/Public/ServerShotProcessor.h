@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PlayerCharacter.h"
+#include "ServerShotProcessor.generated.h"
+
+class UServerLoadGovernor;
+
+/**
+ * Validates the shots all players fired this frame in one batch on the server. Shot RPCs only queue the shot.
+ * A shot waits until the server has applied the move the client sent just before firing, then its ray is taken
+ * from the shooter's aim after that move. After actors tick the level trace is done on the game thread, the rewind
+ * of every target and the hitbox raycast run on worker threads, and the results are committed on the game thread.
+ * The load governor can cap how many shots are taken per frame, the rest wait in order for the next frame.
+ * Waiting shots are rejected once they are older than lm.Governor.MaxShotDeferral or the backlog is longer than
+ * lm.Governor.MaxDeferredShots, and any shot older than the shooter's rollback history is rejected.
+ */
+UCLASS()
+class LATENCYMITIGATION_API UServerShotProcessor : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	void QueueShot(APlayerCharacter* shooter, const FPendingShot& shot);
+
+	// Below this many shots the batch runs on the game thread
+	int32 MinParallelShots = 4;
+
+	// A shot whose move has not arrived after this many seconds is validated with the shooter's current aim
+	float MaxMoveWait = 0.2f;
+
+private:
+	struct FQueuedShot
+	{
+		TWeakObjectPtr<APlayerCharacter> shooter;
+		FPendingShot shot;
+		// Platform time the shot was first held back by the shot cap, 0 while it has not been
+		double deferredSince = 0.0;
+	};
+
+	struct FShotJob
+	{
+		APlayerCharacter* shooter = nullptr;
+		FPendingShot shot;
+		FVector clippedEnd = FVector::ZeroVector;
+		TArray<APlayerCharacter*> targets;
+		TArray<FHitboxPose> poses;
+		int32 hitIndex = INDEX_NONE;
+	};
+
+	void OnWorldPostActorTick(UWorld* world, ELevelTick tickType, float deltaSeconds);
+	int32 RejectStaleShots(const UServerLoadGovernor* governor);
+
+	TArray<FQueuedShot> queuedShots;
+	TArray<FShotJob> jobs;
+	FDelegateHandle postActorTickHandle;
+};
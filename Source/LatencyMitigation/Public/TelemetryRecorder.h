@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "Containers/CircularQueue.h"
+#include <atomic>
+
+class FRunnableThread;
+class IFileHandle;
+
+enum class ETelemetrySeries : uint8
+{
+	Rtt,
+	UnackedDepth,
+	CorrectionMagnitude,
+	RewindAge,
+	HitOutcome,
+	Count
+};
+
+struct FTelemetrySample
+{
+	double time = 0.0;
+	uint32 connectionId = 0;
+	float value = 0.f;
+	ETelemetrySeries series = ETelemetrySeries::Rtt;
+};
+
+/**
+ * Append only columnar telemetry file.
+ *
+ * Layout: one FTelemetryFileHeader followed by fixed size blocks. Every block holds rows of a single series
+ * as three column arrays of BlockRows entries (double time, uint32 connection id, float value), of which the
+ * first RowCount are valid. Block size never changes, so readers can memory map the file and seek by index.
+ */
+struct FTelemetryFileHeader
+{
+	uint32 magic = 0x4C544D4C; // "LMTL"
+	uint32 version = 1;
+	uint32 blockRows = 0;
+	uint32 seriesCount = uint32(ETelemetrySeries::Count);
+	int64 startTicks = 0;
+	uint32 blockBytes = 0;
+	uint32 reserved = 0;
+};
+
+struct FTelemetryBlockHeader
+{
+	uint32 magic = 0x4B4C424C; // "LBLK"
+	uint32 series = 0;
+	uint32 rowCount = 0;
+	uint32 reserved = 0;
+};
+
+/**
+ * Records telemetry samples from the game thread into a lock free single producer queue
+ * and writes them to disk on a background thread.
+ */
+class LATENCYMITIGATION_API FTelemetryRecorder : public FRunnable
+{
+public:
+	static constexpr uint32 BlockRows = 4096;
+
+	FTelemetryRecorder(const FString& inFilePath, uint32 queueCapacity = 1 << 16);
+	virtual ~FTelemetryRecorder();
+
+	bool Start();
+	void Shutdown();
+
+	// Game thread only. Drops the sample if the writer has fallen behind.
+	void Record(ETelemetrySeries series, uint32 connectionId, double time, float value)
+	{
+		if (!queue.Enqueue(FTelemetrySample{ time, connectionId, value, series }))
+		{
+			droppedSamples.Increment();
+		}
+	}
+
+	int32 GetDroppedSamples() const { return droppedSamples.GetValue(); }
+	const FString& GetFilePath() const { return filePath; }
+
+	virtual uint32 Run() override;
+	virtual void Stop() override { stopRequested = true; }
+
+private:
+	struct FColumnBlock
+	{
+		FTelemetryBlockHeader header;
+		double time[BlockRows];
+		uint32 connectionId[BlockRows];
+		float value[BlockRows];
+	};
+
+	void Drain();
+	void WriteBlock(FColumnBlock& block);
+
+	FString filePath;
+	TCircularQueue<FTelemetrySample> queue;
+	FThreadSafeCounter droppedSamples;
+	std::atomic<bool> stopRequested{ false };
+
+	FRunnableThread* thread = nullptr;
+	TUniquePtr<IFileHandle> fileHandle;
+	TArray<FColumnBlock> blocks;
+};
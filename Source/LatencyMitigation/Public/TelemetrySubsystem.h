@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TelemetryRecorder.h"
+#include "TelemetrySubsystem.generated.h"
+
+/**
+ * Owns the telemetry recorder for a game world. One file is written per world to Saved/Telemetry and holds
+ * every match hosted in it, samples are keyed by connection id. Controlled with lm.Telemetry.Enabled.
+ */
+UCLASS()
+class LATENCYMITIGATION_API UTelemetrySubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	void Record(ETelemetrySeries series, uint32 connectionId, float value)
+	{
+		if (recorder)
+		{
+			recorder->Record(series, connectionId, GetWorld()->GetTimeSeconds(), value);
+		}
+	}
+
+private:
+	TUniquePtr<FTelemetryRecorder> recorder;
+};